@@ -0,0 +1,141 @@
+/*
+  ==============================================================================
+
+    DelayDiffuser.cpp
+
+  ==============================================================================
+*/
+
+#include "DelayDiffuser.h"
+
+namespace
+{
+    // Stage lengths at full size in milliseconds, mutually prime at 44.1 and 48 kHz so
+    // the stages never pile their echoes up on the same sample
+    constexpr float stageLengths[DelayDiffuser::maxStages] = { 4.7f, 6.1f, 7.9f, 9.3f, 11.3f, 13.1f, 15.7f, 17.9f };
+
+    // The right channel runs slightly longer stages, which decorrelates the two sides
+    constexpr float channelSpread[DelayDiffuser::maxChannels] = { 1.0f, 1.07f };
+
+    constexpr float minSize = 0.1f;
+    constexpr int alignment = 8;    // floats, 32 bytes
+}
+
+//==============================================================================
+void DelayDiffuser::prepare(double sampleRate)
+{
+    currentSampleRate = sampleRate;
+
+    // One block for every line, each starting on a 32 byte boundary
+    int capacities[maxChannels][maxStages];
+    size_t total = 0;
+
+    for (int channel = 0; channel < maxChannels; ++channel)
+    {
+        for (int stage = 0; stage < maxStages; ++stage)
+        {
+            auto length = static_cast<int>(std::ceil(stageLengths[stage] * channelSpread[channel] / 1000.0 * sampleRate)) + 1;
+            capacities[channel][stage] = (length + alignment - 1) / alignment * alignment;
+            total += (size_t) capacities[channel][stage];
+        }
+    }
+
+    arena.calloc(total + alignment);
+
+    auto* base = arena.get();
+
+    while ((reinterpret_cast<uintptr_t>(base) & (alignment * sizeof(float) - 1)) != 0)
+        ++base;
+
+    for (int channel = 0; channel < maxChannels; ++channel)
+    {
+        for (int stage = 0; stage < maxStages; ++stage)
+        {
+            stages[channel][stage].data = base;
+            stages[channel][stage].capacity = capacities[channel][stage];
+            base += capacities[channel][stage];
+        }
+    }
+
+    currentSize = -1.0f;
+    reset();
+}
+
+void DelayDiffuser::reset() noexcept
+{
+    for (auto& channelStages : stages)
+    {
+        for (auto& stage : channelStages)
+        {
+            if (stage.data != nullptr)
+                juce::FloatVectorOperations::clear(stage.data, stage.capacity);
+
+            stage.position = 0;
+        }
+    }
+}
+
+void DelayDiffuser::setParameters(float amount, float size, int numStages) noexcept
+{
+    coefficient = juce::jlimit(0.0f, 1.0f, amount) * maxCoefficient;
+    activeStages = juce::jlimit(minStages, maxStages, numStages);
+
+    size = juce::jlimit(0.0f, 1.0f, size);
+
+    if (size == currentSize)
+        return;
+
+    currentSize = size;
+    auto scale = juce::jmap(size, minSize, 1.0f);
+
+    for (int channel = 0; channel < maxChannels; ++channel)
+    {
+        for (int stage = 0; stage < maxStages; ++stage)
+        {
+            auto& line = stages[channel][stage];
+            auto delay = static_cast<int>(stageLengths[stage] * channelSpread[channel] * scale / 1000.0 * currentSampleRate);
+            line.delay = juce::jlimit(1, juce::jmax(1, line.capacity - 1), delay);
+        }
+    }
+}
+
+//==============================================================================
+void DelayDiffuser::process(int channel, float* samples, int numSamples) noexcept
+{
+    jassert(juce::isPositiveAndBelow(channel, maxChannels));
+
+    auto g = coefficient;
+
+    // Stage by stage over the whole block, each one only walks its own line
+    for (int stage = 0; stage < activeStages; ++stage)
+    {
+        auto& line = stages[channel][stage];
+
+        if (line.data == nullptr)
+            return;
+
+        auto* data = line.data;
+        auto capacity = line.capacity;
+        auto position = line.position;
+        auto readPosition = position - line.delay;
+
+        if (readPosition < 0)
+            readPosition += capacity;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            auto delayed = data[readPosition];
+            auto w = samples[i] + g * delayed;
+            samples[i] = delayed - g * w;
+            data[position] = w;
+
+            if (++position >= capacity)
+                position = 0;
+
+            if (++readPosition >= capacity)
+                readPosition = 0;
+        }
+
+        line.position = position;
+    }
+}
@@ -0,0 +1,59 @@
+/*
+  ==============================================================================
+
+    DelayDiffuser.h
+
+    A chain of Schroeder allpasses for the classic delay's feedback loop, so
+    every repeat comes back more smeared than the last until the echoes
+    blur into a reverb-like wash. All stage memory sits in one aligned
+    arena, and a block goes through the chain one stage at a time, so each
+    pass only touches one short contiguous line.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+class DelayDiffuser
+{
+public:
+    static constexpr int maxChannels = 2;
+    static constexpr int minStages = 4;
+    static constexpr int maxStages = 8;
+    static constexpr float maxCoefficient = 0.7f;
+
+    DelayDiffuser() = default;
+
+    void prepare(double sampleRate);
+    void reset() noexcept;
+
+    // amount and size 0..1, numStages minStages..maxStages. The chain delays the
+    // signal by the sum of its stages (up to about 85 ms at full size), which in the
+    // feedback loop adds to the delay time.
+    void setParameters(float amount, float size, int numStages) noexcept;
+
+    // In place, numSamples can be anything
+    void process(int channel, float* samples, int numSamples) noexcept;
+
+private:
+    struct Stage
+    {
+        float* data{ nullptr };     // capacity samples in the arena
+        int capacity{ 0 };
+        int delay{ 1 };
+        int position{ 0 };
+    };
+
+    double currentSampleRate{ 44100.0 };
+    juce::HeapBlock<float> arena;
+    Stage stages[maxChannels][maxStages];
+
+    float coefficient{ 0.0f };
+    float currentSize{ -1.0f };
+    int activeStages{ minStages };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DelayDiffuser)
+};
@@ -0,0 +1,427 @@
+/*
+  ==============================================================================
+
+    DspKernels.cpp
+
+    The x86 variants are compiled with per function target attributes (MSVC
+    allows the intrinsics anywhere), so the rest of the plugin keeps the
+    baseline architecture flags and nothing here runs unless select() found
+    the CPU support for it. The FDN entry points are flattened, so the
+    reverb's sample loop and the network step are inlined into one function
+    built for that instruction set.
+
+  ==============================================================================
+*/
+
+#include "DspKernels.h"
+#include "TapeFeedback.h"
+#include "FdnReverb.h"
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+#elif JUCE_ARM && (defined (__ARM_NEON__) || defined (__ARM_NEON) || defined (_M_ARM64))
+ #include <arm_neon.h>
+ #define BAGS_KERNELS_NEON 1
+#endif
+
+#if JUCE_INTEL && (JUCE_GCC || JUCE_CLANG)
+ #define BAGS_TARGET(isa) __attribute__((target (isa)))
+#else
+ #define BAGS_TARGET(isa)
+#endif
+
+// Inlines everything the function calls, whatever target the callees were declared with
+#if JUCE_GCC || JUCE_CLANG
+ #define BAGS_FLATTEN __attribute__((flatten))
+#else
+ #define BAGS_FLATTEN
+#endif
+
+namespace
+{
+    constexpr int numLines = 8;
+
+    //==============================================================================
+    // Scalar, the reference for the others
+    void fdnStepScalar(float* lines, float* dampState, const float* lineGain, float damping,
+                       float inputL, float inputR, float inputGain, float& outL, float& outR) noexcept
+    {
+        outL = outR = 0.0f;
+
+        for (int l = 0; l < numLines; ++l)
+            lines[l] = dampState[l] = lines[l] + damping * (dampState[l] - lines[l]);
+
+        for (int l = 0; l < numLines; l += 2)
+        {
+            outL += lines[l];
+            outR += lines[l + 1];
+        }
+
+        for (int h = 1; h < numLines; h *= 2)
+            for (int i = 0; i < numLines; i += 2 * h)
+                for (int j = i; j < i + h; ++j)
+                {
+                    auto a = lines[j];
+                    auto b = lines[j + h];
+                    lines[j] = a + b;
+                    lines[j + h] = a - b;
+                }
+
+        for (int l = 0; l < numLines; ++l)
+            lines[l] = lines[l] * lineGain[l] + ((l & 1) != 0 ? inputR : inputL) * inputGain;
+    }
+
+   #if JUCE_INTEL
+    //==============================================================================
+    BAGS_TARGET("sse2") void fastTanhSse2(float* samples, int numSamples) noexcept
+    {
+        const auto limit = _mm_set1_ps(3.5f);
+        const auto minusLimit = _mm_set1_ps(-3.5f);
+        int i = 0;
+
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            auto x = _mm_min_ps(limit, _mm_max_ps(minusLimit, _mm_loadu_ps(samples + i)));
+            auto x2 = _mm_mul_ps(x, x);
+            auto numerator = _mm_mul_ps(x, _mm_add_ps(_mm_set1_ps(945.0f), _mm_mul_ps(x2, _mm_add_ps(_mm_set1_ps(105.0f), x2))));
+            auto denominator = _mm_add_ps(_mm_set1_ps(945.0f), _mm_mul_ps(x2, _mm_add_ps(_mm_set1_ps(420.0f), _mm_mul_ps(_mm_set1_ps(15.0f), x2))));
+            _mm_storeu_ps(samples + i, _mm_div_ps(numerator, denominator));
+        }
+
+        for (; i < numSamples; ++i)
+            samples[i] = TapeFeedback::fastTanh(samples[i]);
+    }
+
+    BAGS_TARGET("sse2") void fdnStepSse2(float* lines, float* dampState, const float* lineGain, float damping,
+                                         float inputL, float inputR, float inputGain, float& outL, float& outR) noexcept
+    {
+        const auto damp = _mm_set1_ps(damping);
+        auto lo = _mm_load_ps(lines);
+        auto hi = _mm_load_ps(lines + 4);
+        lo = _mm_add_ps(lo, _mm_mul_ps(damp, _mm_sub_ps(_mm_load_ps(dampState), lo)));
+        hi = _mm_add_ps(hi, _mm_mul_ps(damp, _mm_sub_ps(_mm_load_ps(dampState + 4), hi)));
+        _mm_store_ps(dampState, lo);
+        _mm_store_ps(dampState + 4, hi);
+
+        // even lanes to outL, odd to outR
+        auto sum = _mm_add_ps(lo, hi);
+        sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+        outL = _mm_cvtss_f32(sum);
+        outR = _mm_cvtss_f32(_mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 1, 1, 1)));
+
+        // Butterflies as x * sign + swapped(x), a + b where the sign is 1 and a - b where it's -1.
+        // Strides 1 and 2 within each half, then 4 across them.
+        const auto sign1 = _mm_setr_ps(1.0f, -1.0f, 1.0f, -1.0f);
+        const auto sign2 = _mm_setr_ps(1.0f, 1.0f, -1.0f, -1.0f);
+        lo = _mm_add_ps(_mm_mul_ps(lo, sign1), _mm_shuffle_ps(lo, lo, _MM_SHUFFLE(2, 3, 0, 1)));
+        hi = _mm_add_ps(_mm_mul_ps(hi, sign1), _mm_shuffle_ps(hi, hi, _MM_SHUFFLE(2, 3, 0, 1)));
+        lo = _mm_add_ps(_mm_mul_ps(lo, sign2), _mm_shuffle_ps(lo, lo, _MM_SHUFFLE(1, 0, 3, 2)));
+        hi = _mm_add_ps(_mm_mul_ps(hi, sign2), _mm_shuffle_ps(hi, hi, _MM_SHUFFLE(1, 0, 3, 2)));
+        auto a = _mm_add_ps(lo, hi);
+        auto b = _mm_sub_ps(lo, hi);
+
+        const auto input = _mm_mul_ps(_mm_setr_ps(inputL, inputR, inputL, inputR), _mm_set1_ps(inputGain));
+        _mm_store_ps(lines, _mm_add_ps(_mm_mul_ps(a, _mm_load_ps(lineGain)), input));
+        _mm_store_ps(lines + 4, _mm_add_ps(_mm_mul_ps(b, _mm_load_ps(lineGain + 4)), input));
+    }
+
+    //==============================================================================
+    BAGS_TARGET("avx2") void fastTanhAvx2(float* samples, int numSamples) noexcept
+    {
+        const auto limit = _mm256_set1_ps(3.5f);
+        const auto minusLimit = _mm256_set1_ps(-3.5f);
+        int i = 0;
+
+        for (; i + 8 <= numSamples; i += 8)
+        {
+            auto x = _mm256_min_ps(limit, _mm256_max_ps(minusLimit, _mm256_loadu_ps(samples + i)));
+            auto x2 = _mm256_mul_ps(x, x);
+            auto numerator = _mm256_mul_ps(x, _mm256_add_ps(_mm256_set1_ps(945.0f), _mm256_mul_ps(x2, _mm256_add_ps(_mm256_set1_ps(105.0f), x2))));
+            auto denominator = _mm256_add_ps(_mm256_set1_ps(945.0f), _mm256_mul_ps(x2, _mm256_add_ps(_mm256_set1_ps(420.0f), _mm256_mul_ps(_mm256_set1_ps(15.0f), x2))));
+            _mm256_storeu_ps(samples + i, _mm256_div_ps(numerator, denominator));
+        }
+
+        for (; i < numSamples; ++i)
+            samples[i] = TapeFeedback::fastTanh(samples[i]);
+    }
+
+    // All eight lines in one register
+    BAGS_TARGET("avx2") void fdnStepAvx2(float* lines, float* dampState, const float* lineGain, float damping,
+                                         float inputL, float inputR, float inputGain, float& outL, float& outR) noexcept
+    {
+        auto x = _mm256_load_ps(lines);
+        x = _mm256_add_ps(x, _mm256_mul_ps(_mm256_set1_ps(damping), _mm256_sub_ps(_mm256_load_ps(dampState), x)));
+        _mm256_store_ps(dampState, x);
+
+        auto sum = _mm_add_ps(_mm256_castps256_ps128(x), _mm256_extractf128_ps(x, 1));
+        sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+        outL = _mm_cvtss_f32(sum);
+        outR = _mm_cvtss_f32(_mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 1, 1, 1)));
+
+        const auto sign1 = _mm256_setr_ps(1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f);
+        const auto sign2 = _mm256_setr_ps(1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, -1.0f, -1.0f);
+        const auto sign4 = _mm256_setr_ps(1.0f, 1.0f, 1.0f, 1.0f, -1.0f, -1.0f, -1.0f, -1.0f);
+        x = _mm256_add_ps(_mm256_mul_ps(x, sign1), _mm256_permute_ps(x, _MM_SHUFFLE(2, 3, 0, 1)));
+        x = _mm256_add_ps(_mm256_mul_ps(x, sign2), _mm256_permute_ps(x, _MM_SHUFFLE(1, 0, 3, 2)));
+        x = _mm256_add_ps(_mm256_mul_ps(x, sign4), _mm256_permute2f128_ps(x, x, 1));
+
+        const auto input = _mm256_mul_ps(_mm256_setr_ps(inputL, inputR, inputL, inputR, inputL, inputR, inputL, inputR),
+                                         _mm256_set1_ps(inputGain));
+        _mm256_store_ps(lines, _mm256_add_ps(_mm256_mul_ps(x, _mm256_load_ps(lineGain)), input));
+    }
+
+    //==============================================================================
+    BAGS_TARGET("avx512f") void fastTanhAvx512(float* samples, int numSamples) noexcept
+    {
+        const auto limit = _mm512_set1_ps(3.5f);
+        const auto minusLimit = _mm512_set1_ps(-3.5f);
+        int i = 0;
+
+        for (; i + 16 <= numSamples; i += 16)
+        {
+            auto x = _mm512_min_ps(limit, _mm512_max_ps(minusLimit, _mm512_loadu_ps(samples + i)));
+            auto x2 = _mm512_mul_ps(x, x);
+            auto numerator = _mm512_mul_ps(x, _mm512_add_ps(_mm512_set1_ps(945.0f), _mm512_mul_ps(x2, _mm512_add_ps(_mm512_set1_ps(105.0f), x2))));
+            auto denominator = _mm512_add_ps(_mm512_set1_ps(945.0f), _mm512_mul_ps(x2, _mm512_add_ps(_mm512_set1_ps(420.0f), _mm512_mul_ps(_mm512_set1_ps(15.0f), x2))));
+            _mm512_storeu_ps(samples + i, _mm512_div_ps(numerator, denominator));
+        }
+
+        for (; i < numSamples; ++i)
+            samples[i] = TapeFeedback::fastTanh(samples[i]);
+    }
+   #endif
+
+   #if BAGS_KERNELS_NEON
+    //==============================================================================
+    void fastTanhNeon(float* samples, int numSamples) noexcept
+    {
+        const auto limit = vdupq_n_f32(3.5f);
+        const auto minusLimit = vdupq_n_f32(-3.5f);
+        int i = 0;
+
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            auto x = vminq_f32(limit, vmaxq_f32(minusLimit, vld1q_f32(samples + i)));
+            auto x2 = vmulq_f32(x, x);
+            auto numerator = vmulq_f32(x, vaddq_f32(vdupq_n_f32(945.0f), vmulq_f32(x2, vaddq_f32(vdupq_n_f32(105.0f), x2))));
+            auto denominator = vaddq_f32(vdupq_n_f32(945.0f), vmulq_f32(x2, vaddq_f32(vdupq_n_f32(420.0f), vmulq_f32(vdupq_n_f32(15.0f), x2))));
+            vst1q_f32(samples + i, vdivq_f32(numerator, denominator));
+        }
+
+        for (; i < numSamples; ++i)
+            samples[i] = TapeFeedback::fastTanh(samples[i]);
+    }
+
+    void fdnStepNeon(float* lines, float* dampState, const float* lineGain, float damping,
+                     float inputL, float inputR, float inputGain, float& outL, float& outR) noexcept
+    {
+        const auto damp = vdupq_n_f32(damping);
+        auto lo = vld1q_f32(lines);
+        auto hi = vld1q_f32(lines + 4);
+        lo = vaddq_f32(lo, vmulq_f32(damp, vsubq_f32(vld1q_f32(dampState), lo)));
+        hi = vaddq_f32(hi, vmulq_f32(damp, vsubq_f32(vld1q_f32(dampState + 4), hi)));
+        vst1q_f32(dampState, lo);
+        vst1q_f32(dampState + 4, hi);
+
+        auto sum = vaddq_f32(lo, hi);
+        auto pair = vadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+        outL = vget_lane_f32(pair, 0);
+        outR = vget_lane_f32(pair, 1);
+
+        const float signs1[] = { 1.0f, -1.0f, 1.0f, -1.0f };
+        const float signs2[] = { 1.0f, 1.0f, -1.0f, -1.0f };
+        const auto sign1 = vld1q_f32(signs1);
+        const auto sign2 = vld1q_f32(signs2);
+        lo = vaddq_f32(vmulq_f32(lo, sign1), vrev64q_f32(lo));
+        hi = vaddq_f32(vmulq_f32(hi, sign1), vrev64q_f32(hi));
+        lo = vaddq_f32(vmulq_f32(lo, sign2), vextq_f32(lo, lo, 2));
+        hi = vaddq_f32(vmulq_f32(hi, sign2), vextq_f32(hi, hi, 2));
+        auto a = vaddq_f32(lo, hi);
+        auto b = vsubq_f32(lo, hi);
+
+        const float inputs[] = { inputL * inputGain, inputR * inputGain, inputL * inputGain, inputR * inputGain };
+        const auto input = vld1q_f32(inputs);
+        vst1q_f32(lines, vaddq_f32(vmulq_f32(a, vld1q_f32(lineGain)), input));
+        vst1q_f32(lines + 4, vaddq_f32(vmulq_f32(b, vld1q_f32(lineGain + 4)), input));
+    }
+   #endif
+
+    //==============================================================================
+    // Block entry points, one per instruction set
+    template <FdnReverb::NetworkStep step>
+    inline void fdnProcess(FdnReverb& reverb, float* left, float* right, int numSamples, bool modulated) noexcept
+    {
+        if (modulated)
+            reverb.processSamples<step, true>(left, right, numSamples);
+        else
+            reverb.processSamples<step, false>(left, right, numSamples);
+    }
+
+    BAGS_FLATTEN void fdnProcessScalar(FdnReverb& reverb, float* left, float* right, int numSamples, bool modulated) noexcept
+    {
+        fdnProcess<fdnStepScalar>(reverb, left, right, numSamples, modulated);
+    }
+
+   #if JUCE_INTEL
+    BAGS_TARGET("sse2") BAGS_FLATTEN void fdnProcessSse2(FdnReverb& reverb, float* left, float* right, int numSamples, bool modulated) noexcept
+    {
+        fdnProcess<fdnStepSse2>(reverb, left, right, numSamples, modulated);
+    }
+
+    BAGS_TARGET("avx2") BAGS_FLATTEN void fdnProcessAvx2(FdnReverb& reverb, float* left, float* right, int numSamples, bool modulated) noexcept
+    {
+        fdnProcess<fdnStepAvx2>(reverb, left, right, numSamples, modulated);
+    }
+   #endif
+
+   #if BAGS_KERNELS_NEON
+    BAGS_FLATTEN void fdnProcessNeon(FdnReverb& reverb, float* left, float* right, int numSamples, bool modulated) noexcept
+    {
+        fdnProcess<fdnStepNeon>(reverb, left, right, numSamples, modulated);
+    }
+   #endif
+
+    //==============================================================================
+    const DspKernels kernelTables[] =
+    {
+        { DspKernels::Isa::scalar, "scalar", TapeFeedback::fastTanh, fdnProcessScalar },
+       #if JUCE_INTEL
+        { DspKernels::Isa::sse2,   "SSE2",    fastTanhSse2,   fdnProcessSse2 },
+        { DspKernels::Isa::avx2,   "AVX2",    fastTanhAvx2,   fdnProcessAvx2 },
+        { DspKernels::Isa::avx512, "AVX-512", fastTanhAvx512, fdnProcessAvx2 },   // 8 lines don't fill a 512 bit register
+       #endif
+       #if BAGS_KERNELS_NEON
+        { DspKernels::Isa::neon,   "NEON",    fastTanhNeon,   fdnProcessNeon },
+       #endif
+    };
+
+    bool cpuSupports(DspKernels::Isa isa) noexcept
+    {
+        switch (isa)
+        {
+            case DspKernels::Isa::scalar:   return true;
+            case DspKernels::Isa::sse2:     return juce::SystemStats::hasSSE2();
+            case DspKernels::Isa::avx2:     return juce::SystemStats::hasAVX2();
+            case DspKernels::Isa::avx512:   return juce::SystemStats::hasAVX512F();
+            case DspKernels::Isa::neon:     return juce::SystemStats::hasNeon();
+            case DspKernels::Isa::numIsas:  break;
+        }
+
+        return false;
+    }
+}
+
+//==============================================================================
+const DspKernels* DspKernels::get(Isa isa) noexcept
+{
+    for (auto& table : kernelTables)
+        if (table.isa == isa)
+            return cpuSupports(isa) ? &table : nullptr;
+
+    return nullptr;
+}
+
+const DspKernels& DspKernels::getScalar() noexcept
+{
+    return kernelTables[0];
+}
+
+const DspKernels& DspKernels::select() noexcept
+{
+    for (auto isa : { Isa::avx512, Isa::avx2, Isa::neon, Isa::sse2 })
+        if (auto* table = get(isa))
+            return *table;
+
+    return getScalar();
+}
+
+//==============================================================================
+juce::String DspKernels::createBenchmarkReport(int numSamples)
+{
+    numSamples = juce::jmax(64, numSamples);
+    constexpr int numRuns = 8;
+
+    // Full scale noise with some headroom, into and past the clamp of fastTanh
+    juce::Random random(0x5eed);
+    juce::HeapBlock<float> input((size_t) numSamples), reference((size_t) numSamples), output((size_t) numSamples);
+
+    for (int i = 0; i < numSamples; ++i)
+        input[i] = 8.0f * (random.nextFloat() - 0.5f);
+
+    auto secondsPerSample = [numSamples] (auto&& run)
+    {
+        auto best = std::numeric_limits<double>::max();
+
+        // best of a few runs, the first one also warms the caches up
+        for (int r = 0; r < numRuns; ++r)
+        {
+            auto start = juce::Time::getHighResolutionTicks();
+            run();
+            best = juce::jmin(best, juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start));
+        }
+
+        return best / numSamples;
+    };
+
+    // A fresh (modulated) reverb per run, so every variant starts from the same state
+    juce::HeapBlock<float> right((size_t) numSamples);
+
+    auto runFdn = [&] (const DspKernels& kernels, float* out)
+    {
+        FdnReverb reverb;
+        reverb.setSampleRate(44100.0);
+        reverb.setKernels(kernels);
+
+        juce::FloatVectorOperations::copy(out, input, numSamples);
+        juce::FloatVectorOperations::negate(right, input, numSamples);
+        reverb.processStereo(out, right, numSamples);
+    };
+
+    auto& scalar = getScalar();
+    double scalarTanh = 0.0, scalarFdn = 0.0;
+
+    juce::String report;
+    report << "DSP kernels, " << numSamples << " samples, selected: " << select().name << juce::newLine;
+
+    for (int i = 0; i < (int) Isa::numIsas; ++i)
+    {
+        auto* kernels = get(static_cast<Isa>(i));
+
+        if (kernels == nullptr)
+            continue;
+
+        auto tanhTime = secondsPerSample([&]
+        {
+            juce::FloatVectorOperations::copy(output, input, numSamples);
+            kernels->fastTanh(output, numSamples);
+        });
+
+        juce::FloatVectorOperations::copy(reference, input, numSamples);
+        scalar.fastTanh(reference, numSamples);
+
+        auto tanhError = 0.0f;
+        for (int s = 0; s < numSamples; ++s)
+            tanhError = juce::jmax(tanhError, std::abs(output[s] - reference[s]));
+
+        auto fdnTime = secondsPerSample([&] { runFdn(*kernels, output); });
+        runFdn(scalar, reference);
+
+        auto fdnError = 0.0f;
+        for (int s = 0; s < numSamples; ++s)
+            fdnError = juce::jmax(fdnError, std::abs(output[s] - reference[s]));
+
+        if (kernels == &scalar)
+        {
+            scalarTanh = tanhTime;
+            scalarFdn = fdnTime;
+        }
+
+        report << juce::String(kernels->name).paddedRight(' ', 8)
+               << "fastTanh " << juce::String(tanhTime * 1.0e9, 2) << " ns/sample (x" << juce::String(scalarTanh / tanhTime, 2)
+               << ", max diff " << juce::String(tanhError, 8) << ")   "
+               << "fdnProcess " << juce::String(fdnTime * 1.0e9, 2) << " ns/sample (x" << juce::String(scalarFdn / fdnTime, 2)
+               << ", max diff " << juce::String(fdnError, 8) << ")" << juce::newLine;
+    }
+
+    return report;
+}
@@ -0,0 +1,54 @@
+/*
+  ==============================================================================
+
+    DspKernels.h
+
+    The hot inner loops, each built for several instruction sets and reached
+    through a table of function pointers. prepareToPlay picks the best table
+    the host CPU supports once, so a single binary runs SSE2 on old machines
+    and AVX2/AVX-512 (or NEON on ARM) where it can. Every variant gives the
+    same results as the scalar one, up to float rounding.
+
+    Only the tape saturation and the FDN step are dispatched so far. The
+    delay lines are sample by sample feedback recurrences and the gains go
+    through juce::FloatVectorOperations, so both still run as they are
+    compiled. The AVX-512 table shares the AVX2 FDN step, eight lines don't
+    fill a 512 bit register.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class FdnReverb;
+
+//==============================================================================
+struct DspKernels
+{
+    enum class Isa { scalar, sse2, avx2, avx512, neon, numIsas };
+
+    Isa isa;
+    const char* name;
+
+    // In place TapeFeedback::fastTanh over a block
+    void (*fastTanh)(float* samples, int numSamples) noexcept;
+
+    // A block of FdnReverb::processSamples (right may be nullptr), the whole sample loop
+    // built for this instruction set around its step of the 8 line network
+    void (*fdnProcess)(FdnReverb& reverb, float* left, float* right, int numSamples, bool modulated) noexcept;
+
+    //==============================================================================
+    // Best table for this CPU
+    static const DspKernels& select() noexcept;
+
+    // A specific variant, if it was compiled in and the CPU can run it, else nullptr
+    static const DspKernels* get(Isa isa) noexcept;
+
+    static const DspKernels& getScalar() noexcept;
+
+    // Times every available variant against the scalar one and checks they agree.
+    // Takes a while and allocates, so never call it from the audio thread.
+    static juce::String createBenchmarkReport(int numSamples = 1 << 16);
+};
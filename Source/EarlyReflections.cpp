@@ -0,0 +1,207 @@
+/*
+  ==============================================================================
+
+    EarlyReflections.cpp
+
+  ==============================================================================
+*/
+
+#include "EarlyReflections.h"
+
+namespace
+{
+    constexpr float speedOfSound = 343.0f;      // m/s
+    constexpr float wallReflection = 0.8f;      // pressure reflection coefficient per bounce
+    constexpr float maxReflectionTime = 0.25f;  // seconds, anything later is left to the reverb
+
+    // Smallest room, roomSize scales it up to four times this
+    constexpr float baseRoom[3] = { 3.0f, 2.5f, 2.0f };
+
+    // Source and listener as fractions of the room dimensions
+    constexpr float sourcePos[3]   = { 0.35f, 0.55f, 0.4f };
+    constexpr float listenerPos[3] = { 0.6f,  0.35f, 0.4f };
+
+    // Coordinate of image n along one axis of length size, for a source at pos
+    inline float imageCoordinate(int n, float size, float pos) noexcept
+    {
+        return (n % 2 == 0) ? (float) n * size + pos
+                            : (float) (n + 1) * size - pos;
+    }
+}
+
+//==============================================================================
+void EarlyReflections::prepare(double sampleRate, int maximumBlockSize)
+{
+    currentSampleRate = sampleRate;
+    maxBlockSize = juce::jmax(1, maximumBlockSize);
+
+    auto maxDelaySamples = static_cast<int>(std::ceil((maxPreDelay / 1000.0f + maxReflectionTime) * sampleRate));
+    auto lineSize = juce::nextPowerOfTwo(maxDelaySamples + maxBlockSize);
+
+    line.calloc((size_t) lineSize);
+    lineMask = lineSize - 1;
+
+    reflectionBuffer.setSize(2, maxBlockSize);
+
+    // tap delays are in samples, so they depend on the sample rate
+    buildTaps();
+
+    reset();
+}
+
+void EarlyReflections::reset() noexcept
+{
+    if (line != nullptr)
+        juce::FloatVectorOperations::clear(line, lineMask + 1);
+
+    writePos = 0;
+}
+
+void EarlyReflections::setParameters(float roomSize, float width, float preDelay, int numTaps) noexcept
+{
+    numTaps = juce::jlimit(0, maxTaps, numTaps);
+    preDelay = juce::jlimit(0.0f, maxPreDelay, preDelay);
+
+    if (roomSize == currentRoomSize && width == currentWidth
+         && preDelay == currentPreDelay && numTaps == requestedTaps)
+        return;
+
+    currentRoomSize = roomSize;
+    currentWidth = width;
+    currentPreDelay = preDelay;
+    requestedTaps = numTaps;
+
+    buildTaps();
+}
+
+void EarlyReflections::buildTaps() noexcept
+{
+    float room[3], source[3], listener[3];
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        room[axis] = baseRoom[axis] * (1.0f + 3.0f * juce::jlimit(0.0f, 1.0f, currentRoomSize));
+        source[axis] = sourcePos[axis] * room[axis];
+        listener[axis] = listenerPos[axis] * room[axis];
+    }
+
+    auto distanceTo = [&listener] (float x, float y, float z)
+    {
+        return std::sqrt(juce::square(x - listener[0]) + juce::square(y - listener[1]) + juce::square(z - listener[2]));
+    };
+
+    auto directDistance = distanceTo(source[0], source[1], source[2]);
+    int numImages = 0;
+
+    for (int nx = -imageOrder; nx <= imageOrder; ++nx)
+        for (int ny = -imageOrder; ny <= imageOrder; ++ny)
+            for (int nz = -imageOrder; nz <= imageOrder; ++nz)
+            {
+                auto order = std::abs(nx) + std::abs(ny) + std::abs(nz);
+
+                if (order == 0 || order > imageOrder)
+                    continue;
+
+                auto x = imageCoordinate(nx, room[0], source[0]);
+                auto y = imageCoordinate(ny, room[1], source[1]);
+                auto z = imageCoordinate(nz, room[2], source[2]);
+                auto distance = distanceTo(x, y, z);
+
+                auto& image = images[(size_t) numImages++];
+                image.delay = (distance - directDistance) / speedOfSound;
+                image.gain = std::pow(wallReflection, (float) order) * directDistance / distance;
+                image.pan = (y - listener[1]) / distance;   // sine of the azimuth
+            }
+
+    auto numUsed = juce::jmin(requestedTaps, numImages);
+
+    std::partial_sort(images.begin(), images.begin() + numUsed, images.begin() + numImages,
+                      [] (const Reflection& a, const Reflection& b) { return a.delay < b.delay; });
+
+    auto preDelaySamples = currentPreDelay / 1000.0f * (float) currentSampleRate;
+    auto width = juce::jlimit(0.0f, 1.0f, currentWidth);
+    numActiveTaps = 0;
+
+    for (int i = 0; i < numUsed; ++i)
+    {
+        auto& image = images[(size_t) i];
+
+        if (image.delay > maxReflectionTime)
+            break;
+
+        // constant power pan, narrowed towards the centre by width
+        auto angle = juce::MathConstants<float>::pi * 0.25f * (1.0f + image.pan * width);
+
+        tapDelay[numActiveTaps] = static_cast<int>(preDelaySamples + image.delay * (float) currentSampleRate);
+        tapGainL[numActiveTaps] = image.gain * std::cos(angle);
+        tapGainR[numActiveTaps] = image.gain * std::sin(angle);
+        ++numActiveTaps;
+    }
+}
+
+//==============================================================================
+void EarlyReflections::process(juce::AudioBuffer<float>& buffer, float level, const float* gains) noexcept
+{
+    auto numChannels = juce::jmin(buffer.getNumChannels(), 2);
+
+    if (numChannels == 0 || line == nullptr)
+        return;
+
+    auto* left = buffer.getWritePointer(0);
+    auto* right = numChannels > 1 ? buffer.getWritePointer(1) : nullptr;
+
+    for (int start = 0; start < buffer.getNumSamples(); start += maxBlockSize)
+    {
+        auto numSamples = juce::jmin(maxBlockSize, buffer.getNumSamples() - start);
+        processChunk(left + start, right != nullptr ? right + start : nullptr, numSamples, level,
+                     gains != nullptr ? gains + start : nullptr);
+    }
+}
+
+void EarlyReflections::processChunk(float* left, float* right, int numSamples, float level, const float* gains) noexcept
+{
+    // Write the whole chunk first, every tap can then be read as (at most two) contiguous runs
+    for (int i = 0; i < numSamples; ++i)
+        line[(writePos + i) & lineMask] = right != nullptr ? 0.5f * (left[i] + right[i]) : left[i];
+
+    auto* outL = reflectionBuffer.getWritePointer(0);
+    auto* outR = reflectionBuffer.getWritePointer(1);
+    juce::FloatVectorOperations::clear(outL, numSamples);
+    juce::FloatVectorOperations::clear(outR, numSamples);
+
+    for (int tap = 0; tap < numActiveTaps; ++tap)
+    {
+        auto readPos = (writePos - tapDelay[tap]) & lineMask;
+        auto firstRun = juce::jmin(numSamples, lineMask + 1 - readPos);
+        auto gainL = tapGainL[tap] * level;
+        auto gainR = tapGainR[tap] * level;
+
+        juce::FloatVectorOperations::addWithMultiply(outL, line + readPos, gainL, firstRun);
+        juce::FloatVectorOperations::addWithMultiply(outR, line + readPos, gainR, firstRun);
+
+        if (firstRun < numSamples)
+        {
+            juce::FloatVectorOperations::addWithMultiply(outL + firstRun, line.get(), gainL, numSamples - firstRun);
+            juce::FloatVectorOperations::addWithMultiply(outR + firstRun, line.get(), gainR, numSamples - firstRun);
+        }
+    }
+
+    writePos = (writePos + numSamples) & lineMask;
+
+    if (gains != nullptr)
+    {
+        juce::FloatVectorOperations::multiply(outL, gains, numSamples);
+        juce::FloatVectorOperations::multiply(outR, gains, numSamples);
+    }
+
+    if (right != nullptr)
+    {
+        juce::FloatVectorOperations::add(left, outL, numSamples);
+        juce::FloatVectorOperations::add(right, outR, numSamples);
+    }
+    else
+    {
+        juce::FloatVectorOperations::addWithMultiply(left, outL, 0.5f, numSamples);
+        juce::FloatVectorOperations::addWithMultiply(left, outR, 0.5f, numSamples);
+    }
+}
@@ -0,0 +1,76 @@
+/*
+  ==============================================================================
+
+    EarlyReflections.h
+
+    Sparse tap early reflections. The input is written once into a mono line
+    which also provides the pre-delay, the taps (timing, gain and pan taken
+    from an image source model of a shoebox room) are then summed over whole
+    blocks with vector multiply-adds rather than sample by sample.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+class EarlyReflections
+{
+public:
+    static constexpr int maxTaps = 64;
+    static constexpr float maxPreDelay = 200.0f;   // milliseconds
+
+    EarlyReflections() = default;
+
+    void prepare(double sampleRate, int maximumBlockSize);
+    void reset() noexcept;
+
+    // Rebuilds the taps when anything changed. roomSize and width use the same 0..1
+    // ranges as the reverb controls, preDelay is in milliseconds.
+    void setParameters(float roomSize, float width, float preDelay, int numTaps) noexcept;
+
+    // Adds the reflections, scaled by level (and per sample by gains, if given), on
+    // top of the first two channels of buffer
+    void process(juce::AudioBuffer<float>& buffer, float level, const float* gains = nullptr) noexcept;
+
+    int getNumTaps() const noexcept   { return numActiveTaps; }
+
+private:
+    //==============================================================================
+    void processChunk(float* left, float* right, int numSamples, float level, const float* gains) noexcept;
+    void buildTaps() noexcept;
+
+    struct Reflection
+    {
+        float delay;    // seconds after the direct sound
+        float gain;
+        float pan;      // -1 left .. 1 right
+    };
+
+    //==============================================================================
+    double currentSampleRate{ 44100.0 };
+    int maxBlockSize{ 0 };
+
+    juce::HeapBlock<float> line;        // mono input, shared by the pre-delay and every tap
+    int lineMask{ 0 };
+    int writePos{ 0 };
+
+    juce::AudioBuffer<float> reflectionBuffer;
+
+    float currentRoomSize{ 0.5f }, currentWidth{ 0.5f }, currentPreDelay{ 0.0f };
+    int requestedTaps{ 0 };
+
+    int numActiveTaps{ 0 };
+    int tapDelay[maxTaps]{};
+    float tapGainL[maxTaps]{};
+    float tapGainR[maxTaps]{};
+
+    // Scratch space for the image source model, so rebuilding the taps never allocates
+    static constexpr int imageOrder = 3;
+    static constexpr int maxImages = (2 * imageOrder + 1) * (2 * imageOrder + 1) * (2 * imageOrder + 1);
+    std::array<Reflection, maxImages> images;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (EarlyReflections)
+};
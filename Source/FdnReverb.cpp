@@ -0,0 +1,195 @@
+/*
+  ==============================================================================
+
+    FdnReverb.cpp
+
+  ==============================================================================
+*/
+
+#include "FdnReverb.h"
+
+namespace
+{
+    // Line lengths at 44.1kHz, mutually prime so the modes don't pile up
+    constexpr int baseLineLengths[FdnReverb::numLines] = { 1153, 1327, 1559, 1733, 1871, 2039, 2179, 2351 };
+
+    // Same scaling as juce::Reverb so switching algorithms keeps the levels close
+    constexpr float wetScaleFactor = 3.0f;
+    constexpr float dryScaleFactor = 2.0f;
+
+    constexpr float maxModulationDepth = 4.0f;  // samples at 44.1kHz
+}
+
+//==============================================================================
+void FdnReverb::setSampleRate(double sampleRate)
+{
+    jassert(sampleRate > 0);
+    currentSampleRate = sampleRate;
+
+    auto scale = sampleRate / 44100.0;
+    int totalLength = 0;
+
+    for (int l = 0; l < numLines; ++l)
+    {
+        lineLength[l] = juce::roundToInt(baseLineLengths[l] * scale);
+        totalLength += lineLength[l];
+    }
+
+    lineMemory.calloc((size_t) totalLength);
+
+    for (int l = 0, offset = 0; l < numLines; offset += lineLength[l++])
+        lines[l] = lineMemory + offset;
+
+    modulationDepth = static_cast<float>(maxModulationDepth * scale);
+
+    // Slightly different rates, so the lines never move together. reset() sets the phases.
+    for (int l = 0; l < numLines; ++l)
+    {
+        auto rate = 0.3 + 0.11 * l;
+        auto increment = juce::MathConstants<double>::twoPi * rate / sampleRate;
+
+        lfoRotSin[l] = static_cast<float>(std::sin(increment));
+        lfoRotCos[l] = static_cast<float>(std::cos(increment));
+    }
+
+    wetGain1.reset(sampleRate, 0.01);
+    wetGain2.reset(sampleRate, 0.01);
+    dryGain.reset(sampleRate, 0.01);
+
+    gainRoomSize = -1.0f;     // line lengths changed, so the gains must be recomputed
+    setParameters(parameters);
+    reset();
+}
+
+double FdnReverb::getDecayTime(float roomSize) noexcept
+{
+    return 0.25 * std::pow(40.0, (double) juce::jlimit(0.0f, 1.0f, roomSize));
+}
+
+void FdnReverb::setParameters(const juce::Reverb::Parameters& newParameters) noexcept
+{
+    parameters = newParameters;
+    frozen = parameters.freezeMode >= 0.5f;   // same threshold as juce::Reverb
+
+    // This is called every control period while modulated, so the pow()s only run when
+    // the size actually moves
+    if (parameters.roomSize != gainRoomSize)
+    {
+        gainRoomSize = parameters.roomSize;
+
+        auto decaySeconds = getDecayTime(parameters.roomSize);
+        auto normalisation = 1.0 / std::sqrt((double) numLines);
+
+        // Per line gain for the same decay on every line, whatever its length
+        for (int l = 0; l < numLines; ++l)
+            lineGain[l] = static_cast<float>(normalisation * std::pow(10.0, -3.0 * lineLength[l] / (decaySeconds * currentSampleRate)));
+    }
+
+    dampCoefficient = parameters.damping * 0.6f;
+
+    auto wet = parameters.wetLevel * wetScaleFactor;
+    wetGain1.setTargetValue(0.5f * wet * (1.0f + parameters.width));
+    wetGain2.setTargetValue(0.5f * wet * (1.0f - parameters.width));
+    dryGain.setTargetValue(parameters.dryLevel * dryScaleFactor);
+}
+
+void FdnReverb::reset() noexcept
+{
+    int totalLength = 0;
+
+    for (int l = 0; l < numLines; ++l)
+    {
+        totalLength += lineLength[l];
+        writePos[l] = 0;
+        dampState[l] = 0.0f;
+
+        // Spread out starting phases, the same every time so a reset render is repeatable
+        auto phase = juce::MathConstants<double>::twoPi * l / numLines;
+        lfoSin[l] = static_cast<float>(std::sin(phase));
+        lfoCos[l] = static_cast<float>(std::cos(phase));
+    }
+
+    if (lineMemory != nullptr)
+        juce::FloatVectorOperations::clear(lineMemory, totalLength);
+
+    // Don't ramp in from whatever the gains were doing before
+    wetGain1.setCurrentAndTargetValue(wetGain1.getTargetValue());
+    wetGain2.setCurrentAndTargetValue(wetGain2.getTargetValue());
+    dryGain.setCurrentAndTargetValue(dryGain.getTargetValue());
+}
+
+//==============================================================================
+void FdnReverb::processStereo(float* left, float* right, int numSamples) noexcept
+{
+    jassert(left != nullptr && right != nullptr);
+
+    if (frozen)
+        processFrozen(left, right, numSamples);
+    else if (lineMemory != nullptr)
+        kernels->fdnProcess(*this, left, right, numSamples, modulationEnabled);
+}
+
+void FdnReverb::processMono(float* samples, int numSamples) noexcept
+{
+    jassert(samples != nullptr);
+
+    if (frozen)
+        processFrozen(samples, nullptr, numSamples);
+    else if (lineMemory != nullptr)
+        kernels->fdnProcess(*this, samples, nullptr, numSamples, modulationEnabled);
+}
+
+void FdnReverb::processFrozen(float* left, float* right, int numSamples) noexcept
+{
+    if (lineMemory == nullptr)
+        return;
+
+    // Reading the oldest sample and writing it straight back would be a no-op, so the
+    // lines aren't written at all. What's left is summing contiguous runs of them.
+    constexpr int chunkSize = 64;
+    alignas(32) float even[chunkSize];
+    alignas(32) float odd[chunkSize];
+
+    for (int start = 0; start < numSamples; start += chunkSize)
+    {
+        auto numChunkSamples = juce::jmin(chunkSize, numSamples - start);
+        juce::FloatVectorOperations::clear(even, numChunkSamples);
+        juce::FloatVectorOperations::clear(odd, numChunkSamples);
+
+        for (int l = 0; l < numLines; ++l)
+        {
+            auto* sum = (l & 1) != 0 ? odd : even;
+
+            for (int done = 0; done < numChunkSamples;)
+            {
+                auto run = juce::jmin(numChunkSamples - done, lineLength[l] - writePos[l]);
+                juce::FloatVectorOperations::add(sum + done, lines[l] + writePos[l], run);
+
+                done += run;
+                writePos[l] += run;
+
+                if (writePos[l] >= lineLength[l])
+                    writePos[l] = 0;
+            }
+        }
+
+        for (int i = 0; i < numChunkSamples; ++i)
+        {
+            auto wet1 = wetGain1.getNextValue();
+            auto wet2 = wetGain2.getNextValue();
+            auto dry = dryGain.getNextValue();
+            auto dryL = left[start + i];
+
+            if (right != nullptr)
+            {
+                auto dryR = right[start + i];
+                left[start + i]  = even[i] * wet1 + odd[i] * wet2 + dryL * dry;
+                right[start + i] = odd[i] * wet1 + even[i] * wet2 + dryR * dry;
+            }
+            else
+            {
+                left[start + i] = (even[i] + odd[i]) * wet1 + dryL * dry;
+            }
+        }
+    }
+}
@@ -0,0 +1,197 @@
+/*
+  ==============================================================================
+
+    FdnReverb.h
+
+    Feedback delay network reverb. Eight delay lines are mixed through a
+    normalised Hadamard matrix (applied as a fast Walsh-Hadamard transform),
+    each line has its own damping filter and an optional slow modulation of
+    its length. Takes the same parameters as juce::Reverb so the two can be
+    swapped in applyReverb.
+
+    With freezeMode set the network stops writing altogether: every line
+    just plays its contents round and round, which holds the tail forever
+    for the price of reading it.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DspKernels.h"
+
+//==============================================================================
+class FdnReverb
+{
+public:
+    static constexpr int numLines = 8;
+
+    FdnReverb() = default;
+
+    void setSampleRate(double sampleRate);
+    void setParameters(const juce::Reverb::Parameters& newParameters) noexcept;
+    const juce::Reverb::Parameters& getParameters() const noexcept  { return parameters; }
+
+    // Time the tail takes to fall by 60 dB, roomSize sets it from 0.25s up to 10s
+    static double getDecayTime(float roomSize) noexcept;
+
+    // Slowly sweeps each line length by a few samples, which breaks up metallic ringing
+    void setModulationEnabled(bool shouldModulate) noexcept        { modulationEnabled = shouldModulate; }
+
+    void reset() noexcept;
+
+    // Instruction set variant of the inner loop, see DspKernels::select
+    void setKernels(const DspKernels& newKernels) noexcept         { kernels = &newKernels; }
+
+    void processStereo(float* left, float* right, int numSamples) noexcept;
+    void processMono(float* samples, int numSamples) noexcept;
+
+    //==============================================================================
+    // The sample loop around one step of the line network (see DspKernels::fdnProcess).
+    // Each kernel table instantiates it with its own step, inside a function built for
+    // its instruction set, so the whole loop is compiled for that set and the dispatch
+    // happens once per block. right may be nullptr for mono.
+    using NetworkStep = void (*)(float* lines, float* dampState, const float* lineGain, float damping,
+                                 float inputL, float inputR, float inputGain, float& outL, float& outR) noexcept;
+
+    template <NetworkStep step, bool modulated>
+    void processSamples(float* left, float* right, int numSamples) noexcept;
+
+private:
+    //==============================================================================
+    template <bool modulated>
+    void readLines(float* lineOut) noexcept;
+
+    void processFrozen(float* left, float* right, int numSamples) noexcept;
+
+    void writeLines(const float* lineIn) noexcept;
+    void advanceModulation() noexcept;
+
+    //==============================================================================
+    static constexpr float inputGain = 0.02f;
+
+    juce::Reverb::Parameters parameters;
+    double currentSampleRate{ 44100.0 };
+    const DspKernels* kernels{ &DspKernels::getScalar() };
+
+    juce::HeapBlock<float> lineMemory;     // all lines, back to back
+    float* lines[numLines]{};
+    int lineLength[numLines]{};
+    int writePos[numLines]{};
+
+    alignas(32) float lineGain[numLines]{};
+    float gainRoomSize{ -1.0f };       // roomSize lineGain was computed for
+    alignas(32) float dampState[numLines]{};
+    float dampCoefficient{ 0.0f };
+
+    bool modulationEnabled{ true };
+    bool frozen{ false };
+    float modulationDepth{ 0.0f };     // in samples
+    alignas(32) float lfoSin[numLines]{};
+    alignas(32) float lfoCos[numLines]{};
+    alignas(32) float lfoRotSin[numLines]{};
+    alignas(32) float lfoRotCos[numLines]{};
+
+    juce::SmoothedValue<float> wetGain1, wetGain2, dryGain;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FdnReverb)
+};
+
+//==============================================================================
+template <FdnReverb::NetworkStep step, bool modulated>
+void FdnReverb::processSamples(float* left, float* right, int numSamples) noexcept
+{
+    for (int i = 0; i < numSamples; ++i)
+    {
+        alignas(32) float lineOut[numLines];
+        readLines<modulated>(lineOut);
+
+        auto dryL = left[i];
+        auto dryR = right != nullptr ? right[i] : dryL;
+
+        // Per line damping (one pole lowpass), the outputs tap the filtered lines, then
+        // the Hadamard mix (normalised in the line gains). Left input feeds the even
+        // lines, right input the odd ones.
+        float outL, outR;
+        step(lineOut, dampState, lineGain, dampCoefficient, dryL, dryR, inputGain, outL, outR);
+
+        writeLines(lineOut);
+
+        if (modulated)
+            advanceModulation();
+
+        auto wet1 = wetGain1.getNextValue();
+        auto wet2 = wetGain2.getNextValue();
+        auto dry = dryGain.getNextValue();
+
+        if (right != nullptr)
+        {
+            left[i]  = outL * wet1 + outR * wet2 + dryL * dry;
+            right[i] = outR * wet1 + outL * wet2 + dryR * dry;
+        }
+        else
+        {
+            left[i] = (outL + outR) * wet1 + dryL * dry;
+        }
+    }
+
+    if (modulated)
+    {
+        // Keep the quadrature oscillators from drifting off the unit circle
+        for (int l = 0; l < numLines; ++l)
+        {
+            auto norm = 1.0f / std::sqrt(lfoSin[l] * lfoSin[l] + lfoCos[l] * lfoCos[l]);
+            lfoSin[l] *= norm;
+            lfoCos[l] *= norm;
+        }
+    }
+}
+
+template <bool modulated>
+void FdnReverb::readLines(float* lineOut) noexcept
+{
+    for (int l = 0; l < numLines; ++l)
+    {
+        if (modulated)
+        {
+            // Delay sweeps between lineLength - 2 * depth and lineLength, so never past the write head
+            auto pos = static_cast<float>(writePos[l]) - static_cast<float>(lineLength[l]) + modulationDepth * (1.0f + lfoSin[l]);
+
+            if (pos < 0.0f)
+                pos += static_cast<float>(lineLength[l]);
+
+            auto index = juce::jmin(static_cast<int>(pos), lineLength[l] - 1);
+            auto frac = pos - static_cast<float>(index);
+            auto next = index + 1 < lineLength[l] ? index + 1 : 0;
+
+            lineOut[l] = lines[l][index] + frac * (lines[l][next] - lines[l][index]);
+        }
+        else
+        {
+            lineOut[l] = lines[l][writePos[l]];
+        }
+    }
+}
+
+inline void FdnReverb::writeLines(const float* lineIn) noexcept
+{
+    for (int l = 0; l < numLines; ++l)
+    {
+        lines[l][writePos[l]] = lineIn[l];
+
+        if (++writePos[l] >= lineLength[l])
+            writePos[l] = 0;
+    }
+}
+
+inline void FdnReverb::advanceModulation() noexcept
+{
+    for (int l = 0; l < numLines; ++l)
+    {
+        auto s = lfoSin[l];
+        auto c = lfoCos[l];
+        lfoSin[l] = s * lfoRotCos[l] + c * lfoRotSin[l];
+        lfoCos[l] = c * lfoRotCos[l] - s * lfoRotSin[l];
+    }
+}
@@ -0,0 +1,238 @@
+/*
+  ==============================================================================
+
+    HalfBandResampler.cpp
+
+  ==============================================================================
+*/
+
+#include "HalfBandResampler.h"
+
+namespace
+{
+    // Blackman windowed sinc, only the non-zero side taps. Scaled so that the
+    // centre tap (0.5) plus both sides sum to exactly one.
+    HalfBandResampler::Coefficients designHalfBand()
+    {
+        HalfBandResampler::Coefficients coefficients;
+        constexpr auto numTaps = HalfBandResampler::numTaps;
+        constexpr auto centre = numTaps / 2;
+        auto pi = juce::MathConstants<double>::pi;
+
+        double sum = 0.0;
+
+        for (int j = 0; j < HalfBandResampler::numSidePairs; ++j)
+        {
+            auto offset = 2 * j + 1;
+            auto k = (double) (centre + offset);
+            auto window = 0.42 - 0.5 * std::cos(2.0 * pi * k / (numTaps - 1)) + 0.08 * std::cos(4.0 * pi * k / (numTaps - 1));
+            auto sinc = std::sin(pi * offset / 2.0) / (pi * offset);
+
+            coefficients[(size_t) j] = static_cast<float>(sinc * window);
+            sum += sinc * window;
+        }
+
+        for (auto& c : coefficients)
+            c = static_cast<float>(c * 0.25 / sum);
+
+        return coefficients;
+    }
+}
+
+//==============================================================================
+void HalfBandResampler::prepare()
+{
+    // Every stage and channel of every instance uses the same taps
+    static const Coefficients blackman31 = designHalfBand();
+
+    coefficients = &blackman31;
+    reset();
+}
+
+void HalfBandResampler::reset() noexcept
+{
+    std::fill(std::begin(decimatorHistory), std::end(decimatorHistory), 0.0f);
+    std::fill(std::begin(interpolatorHistory), std::end(interpolatorHistory), 0.0f);
+    decimatorPos = 0;
+    decimatorPhase = false;
+    interpolatorPos = 0;
+}
+
+int HalfBandResampler::decimate(const float* input, int numInput, float* output) noexcept
+{
+    constexpr int centre = numTaps / 2;
+    auto& c = *coefficients;
+    int numOutput = 0;
+
+    for (int i = 0; i < numInput; ++i)
+    {
+        decimatorHistory[decimatorPos] = decimatorHistory[decimatorPos + numTaps] = input[i];
+        auto* window = decimatorHistory + decimatorPos + 1;   // oldest .. newest
+
+        if (++decimatorPos >= numTaps)
+            decimatorPos = 0;
+
+        // only every other output is needed, that's the polyphase saving
+        if (decimatorPhase)
+        {
+            auto sum = 0.5f * window[centre];
+
+            for (int j = 0; j < numSidePairs; ++j)
+                sum += c[(size_t) j] * (window[centre - 2 * j - 1] + window[centre + 2 * j + 1]);
+
+            output[numOutput++] = sum;
+        }
+
+        decimatorPhase = ! decimatorPhase;
+    }
+
+    return numOutput;
+}
+
+void HalfBandResampler::interpolate(const float* input, int numInput, float* output) noexcept
+{
+    constexpr int centre = interpolatorSize / 2;
+    auto& c = *coefficients;
+
+    for (int i = 0; i < numInput; ++i)
+    {
+        interpolatorHistory[interpolatorPos] = interpolatorHistory[interpolatorPos + interpolatorSize] = input[i];
+        auto* window = interpolatorHistory + interpolatorPos + 1;
+
+        if (++interpolatorPos >= interpolatorSize)
+            interpolatorPos = 0;
+
+        // Even phase uses all the side taps, the odd phase is just the (delayed) centre tap
+        float sum = 0.0f;
+
+        for (int j = 0; j < numSidePairs; ++j)
+            sum += c[(size_t) j] * (window[centre + j] + window[centre - 1 - j]);
+
+        output[2 * i] = 2.0f * sum;
+        output[2 * i + 1] = window[centre];
+    }
+}
+
+//==============================================================================
+void ReducedRateProcessor::prepare(int maximumBlockSize)
+{
+    maxBlockSize = juce::jmax(1, maximumBlockSize);
+
+    for (int stage = 0; stage < maxStages; ++stage)
+    {
+        stageBuffers[stage].setSize(maxChannels, (maxBlockSize >> (stage + 1)) + 1);
+
+        for (int channel = 0; channel < maxChannels; ++channel)
+        {
+            decimators[stage][channel].prepare();
+            interpolators[stage][channel].prepare();
+        }
+    }
+
+    for (auto& buffer : upsampleBuffers)
+        buffer.setSize(maxChannels, maxBlockSize + (1 << maxStages));
+
+    fifoSize = maxBlockSize + 2 * (1 << maxStages);
+    fifo.setSize(maxChannels, fifoSize);
+
+    reset();
+}
+
+void ReducedRateProcessor::reset() noexcept
+{
+    for (int stage = 0; stage < maxStages; ++stage)
+        for (int channel = 0; channel < maxChannels; ++channel)
+        {
+            decimators[stage][channel].reset();
+            interpolators[stage][channel].reset();
+        }
+
+    // Prime the FIFO so a block which isn't a multiple of the factor never runs it dry
+    fifo.clear();
+    fifoRead = 0;
+    fifoWrite = getFactor() - 1;
+}
+
+void ReducedRateProcessor::setNumStages(int newNumStages) noexcept
+{
+    newNumStages = juce::jlimit(1, maxStages, newNumStages);
+
+    if (newNumStages != numStages)
+    {
+        numStages = newNumStages;
+        reset();
+    }
+}
+
+juce::AudioBuffer<float>& ReducedRateProcessor::downsample(const juce::AudioBuffer<float>& input, int startSample, int numSamples,
+                                                          int numChannels, int& numReducedSamples) noexcept
+{
+    jassert(numSamples <= maxBlockSize);
+    numChannels = juce::jmin(numChannels, (int) maxChannels);
+    numReducedSamples = 0;
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        auto* source = input.getReadPointer(channel, startSample);
+        auto count = numSamples;
+
+        for (int stage = 0; stage < numStages; ++stage)
+        {
+            auto* destination = stageBuffers[stage].getWritePointer(channel);
+            count = decimators[stage][channel].decimate(source, count, destination);
+            source = destination;
+        }
+
+        numReducedSamples = count;   // the same for every channel, they share a phase
+    }
+
+    return stageBuffers[numStages - 1];
+}
+
+void ReducedRateProcessor::upsampleAndAdd(juce::AudioBuffer<float>& output, int startSample, int numSamples,
+                                          int numChannels, int numReducedSamples, const float* gains) noexcept
+{
+    numChannels = juce::jmin(numChannels, (int) maxChannels);
+    auto numUpsampled = numReducedSamples << numStages;
+    auto writePos = fifoWrite;
+    auto readPos = fifoRead;
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        const float* source = stageBuffers[numStages - 1].getReadPointer(channel);
+        auto count = numReducedSamples;
+
+        for (int stage = numStages; --stage >= 0;)
+        {
+            auto* destination = upsampleBuffers[stage & 1].getWritePointer(channel);
+            interpolators[stage][channel].interpolate(source, count, destination);
+            source = destination;
+            count *= 2;
+        }
+
+        auto* fifoData = fifo.getWritePointer(channel);
+
+        writePos = fifoWrite;
+
+        for (int i = 0; i < numUpsampled; ++i)
+        {
+            fifoData[writePos] = source[i];
+            if (++writePos >= fifoSize)
+                writePos = 0;
+        }
+
+        auto* destination = output.getWritePointer(channel, startSample);
+
+        readPos = fifoRead;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            destination[i] += gains != nullptr ? fifoData[readPos] * gains[i] : fifoData[readPos];
+            if (++readPos >= fifoSize)
+                readPos = 0;
+        }
+    }
+
+    fifoWrite = writePos;
+    fifoRead = readPos;
+}
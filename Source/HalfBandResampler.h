@@ -0,0 +1,103 @@
+/*
+  ==============================================================================
+
+    HalfBandResampler.h
+
+    Polyphase half-band decimation and interpolation by two, and a small
+    helper which cascades them so a block can be processed at a half or a
+    quarter of the host rate and brought back up again.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+// One 31 tap half-band stage for a single channel. Every other tap of a
+// half-band filter is zero, so only the centre tap and the eight symmetric
+// side tap pairs are ever multiplied.
+class HalfBandResampler
+{
+public:
+    static constexpr int numTaps = 31;
+    static constexpr int numSidePairs = (numTaps + 1) / 4;
+
+    using Coefficients = std::array<float, numSidePairs>;
+
+    HalfBandResampler() = default;
+
+    void prepare();
+    void reset() noexcept;
+
+    // Consumes numInput samples and returns how many (numInput / 2, give or take
+    // the phase left over from the last call) were written to output.
+    int decimate(const float* input, int numInput, float* output) noexcept;
+
+    // Writes 2 * numInput samples to output
+    void interpolate(const float* input, int numInput, float* output) noexcept;
+
+private:
+    const Coefficients* coefficients{ nullptr };
+
+    // Histories are written twice, numTaps apart, so the newest window is always contiguous
+    float decimatorHistory[2 * numTaps]{};
+    int decimatorPos{ 0 };
+    bool decimatorPhase{ false };
+
+    static constexpr int interpolatorSize = 2 * numSidePairs;
+    float interpolatorHistory[2 * interpolatorSize]{};
+    int interpolatorPos{ 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (HalfBandResampler)
+};
+
+//==============================================================================
+// Takes a block down by 2^numStages, lets the caller process it at the reduced
+// rate, then interpolates it back up and adds it to the output. A short FIFO
+// absorbs blocks that aren't a multiple of the rate factor, at the price of a
+// fixed extra latency of up to factor - 1 samples.
+class ReducedRateProcessor
+{
+public:
+    static constexpr int maxStages = 2;
+    static constexpr int maxChannels = 2;
+
+    ReducedRateProcessor() = default;
+
+    void prepare(int maximumBlockSize);
+    void reset() noexcept;
+
+    void setNumStages(int newNumStages) noexcept;
+    int getNumStages() const noexcept                  { return numStages; }
+    int getFactor() const noexcept                     { return 1 << numStages; }
+
+    // Decimates numSamples of input (starting at startSample) and returns the reduced
+    // rate block. Its length is written to numReducedSamples.
+    juce::AudioBuffer<float>& downsample(const juce::AudioBuffer<float>& input, int startSample, int numSamples,
+                                         int numChannels, int& numReducedSamples) noexcept;
+
+    // Brings numReducedSamples of the reduced block back to full rate and adds
+    // numSamples of it to output, starting at startSample. gains, if given, holds
+    // a gain for each of the numSamples being added.
+    void upsampleAndAdd(juce::AudioBuffer<float>& output, int startSample, int numSamples,
+                        int numChannels, int numReducedSamples, const float* gains = nullptr) noexcept;
+
+    int getMaxBlockSize() const noexcept               { return maxBlockSize; }
+
+private:
+    int numStages{ 1 };
+    int maxBlockSize{ 0 };
+
+    HalfBandResampler decimators[maxStages][maxChannels];
+    HalfBandResampler interpolators[maxStages][maxChannels];
+
+    juce::AudioBuffer<float> stageBuffers[maxStages];   // output of each decimation stage
+    juce::AudioBuffer<float> upsampleBuffers[2];        // ping-pong for the interpolation stages
+
+    juce::AudioBuffer<float> fifo;
+    int fifoSize{ 0 }, fifoRead{ 0 }, fifoWrite{ 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ReducedRateProcessor)
+};
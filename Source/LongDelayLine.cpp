@@ -0,0 +1,79 @@
+/*
+  ==============================================================================
+
+    LongDelayLine.cpp
+
+  ==============================================================================
+*/
+
+#include "LongDelayLine.h"
+
+//==============================================================================
+void LongDelayLine::prepare(double sampleRate, double maxDelaySeconds)
+{
+    release();
+
+    nearBuffer.calloc(nearSize);
+
+    auto maxDelaySamples = static_cast<int>(std::ceil(sampleRate * maxDelaySeconds));
+    maxBlocks = (maxDelaySamples + blockSize - 1) / blockSize;
+
+    // The table itself is tiny, the blocks it points to are committed later on
+    blocks.resize((size_t) maxBlocks);
+}
+
+void LongDelayLine::release()
+{
+    nearBuffer.free();
+    nearWritePos = 0;
+
+    blocks.clear();
+    numCommittedBlocks = 0;
+    maxBlocks = 0;
+
+    writePos = 0;
+    activeLength = 0;
+    writtenLength = 0;
+}
+
+void LongDelayLine::clear() noexcept
+{
+    // The near ring is small enough to clear, the blocks can be tens of MB
+    if (nearBuffer != nullptr)
+        juce::FloatVectorOperations::clear(nearBuffer, nearSize);
+
+    nearWritePos = 0;
+    writePos = 0;
+    activeLength = 0;
+    writtenLength = 0;
+}
+
+void LongDelayLine::commit(int numSamples)
+{
+    BAGS_RT_ASSERT_NOT_AUDIO_THREAD("LongDelayLine::commit on the audio thread");
+
+    auto blocksNeeded = juce::jmin(maxBlocks, (numSamples + blockSize - 1) / blockSize);
+
+    for (auto i = numCommittedBlocks.load(); i < blocksNeeded; ++i)
+    {
+        blocks[(size_t) i].reset(new juce::uint16[(size_t) blockSize]());   // zero = silence
+        numCommittedBlocks.store(i + 1, std::memory_order_release);
+    }
+}
+
+void LongDelayLine::decommit()
+{
+    BAGS_RT_ASSERT_NOT_AUDIO_THREAD("LongDelayLine::decommit on the audio thread");
+
+    for (auto& block : blocks)
+        block.reset();
+
+    numCommittedBlocks = 0;
+    clear();
+}
+
+size_t LongDelayLine::getCommittedBytes() const noexcept
+{
+    return (size_t) numCommittedBlocks.load() * blockSize * sizeof(juce::uint16)
+         + (nearBuffer != nullptr ? nearSize * sizeof(float) : 0);
+}
@@ -0,0 +1,157 @@
+/*
+  ==============================================================================
+
+    LongDelayLine.h
+
+    Delay storage for very long (looper style) delay times. The most recent
+    samples are kept in a small float ring for the fast path, everything
+    further back is stored as half floats in fixed size blocks which are only
+    allocated once the delay time actually needs them.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "RealtimeSafetyChecker.h"
+
+//==============================================================================
+class LongDelayLine
+{
+public:
+    static constexpr int blockSize = 1 << 15;   // samples per half float block
+    static constexpr int nearSize  = 1 << 14;   // float32 samples kept around the write head
+
+    LongDelayLine() = default;
+
+    // Allocates the near ring and the (empty) block table. No blocks are committed here.
+    void prepare(double sampleRate, double maxDelaySeconds);
+    void release();
+
+    // Silences the line without touching the committed blocks: only history written since
+    // is read back, so the old contents are overwritten as the write head gets to them
+    void clear() noexcept;
+
+    // Commits enough blocks to hold numSamples of history. Call this from the
+    // message thread - it allocates. The audio thread picks the new blocks up
+    // the next time its write head wraps.
+    void commit(int numSamples);
+
+    // Frees every committed block and silences the line. Message thread only, and only
+    // while the audio thread is guaranteed to keep off the line.
+    void decommit();
+
+    int getMaxDelaySamples() const noexcept         { return maxBlocks * blockSize; }
+    size_t getCommittedBytes() const noexcept;
+    bool hasCommittedBlocks() const noexcept        { return numCommittedBlocks.load() > 0; }
+
+    //==============================================================================
+    float read(int delaySamples) const noexcept
+    {
+        if (delaySamples < nearSize)
+            return nearBuffer[(nearWritePos - delaySamples) & (nearSize - 1)];
+
+        if (delaySamples > writtenLength)
+            return 0.0f;
+
+        auto pos = writePos - delaySamples;
+        if (pos < 0)
+            pos += activeLength;
+
+        return halfToFloat(blocks[(size_t) (pos / blockSize)][pos % blockSize]);
+    }
+
+    // Fractional delay, for swept delay times
+    float readInterpolated(float delaySamples) const noexcept
+    {
+        auto whole = static_cast<int>(delaySamples);
+        auto a = read(whole);
+        return a + (delaySamples - (float) whole) * (read(whole + 1) - a);
+    }
+
+    void write(float sample) noexcept
+    {
+        nearBuffer[nearWritePos] = sample;
+        nearWritePos = (nearWritePos + 1) & (nearSize - 1);
+
+        if (activeLength == 0)
+        {
+            // nothing committed yet (or at the last wrap) - see if the message thread has caught up
+            activeLength = numCommittedBlocks.load(std::memory_order_acquire) * blockSize;
+            writePos = 0;
+
+            if (activeLength == 0)
+                return;
+        }
+
+        blocks[(size_t) (writePos / blockSize)][writePos % blockSize] = floatToHalf(sample);
+
+        if (writtenLength < activeLength)
+            ++writtenLength;
+
+        if (++writePos >= activeLength)
+        {
+            // Grow into newly committed blocks instead of wrapping, so the history
+            // already written stays at the same distance from the write head.
+            auto committedLength = numCommittedBlocks.load(std::memory_order_acquire) * blockSize;
+
+            if (committedLength > activeLength)
+                activeLength = committedLength;
+            else
+                writePos = 0;
+        }
+    }
+
+    //==============================================================================
+    // IEEE 754 binary16 conversion. Rounds to nearest, flushes values below the
+    // half float normal range to zero and clamps overflow to the largest finite value.
+    static juce::uint16 floatToHalf(float value) noexcept
+    {
+        juce::uint32 bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+
+        auto sign = (juce::uint16) ((bits >> 16) & 0x8000u);
+        auto exponent = (int) ((bits >> 23) & 0xff) - 127 + 15;
+        auto mantissa = bits & 0x7fffffu;
+
+        if (exponent <= 0)
+            return sign;
+
+        if (exponent >= 31)
+            return (juce::uint16) (sign | 0x7bffu);
+
+        auto half = (juce::uint32) ((exponent << 10) | (mantissa >> 13));
+        half += (mantissa >> 12) & 1u;   // round, a carry into the exponent is still correct
+
+        return (juce::uint16) (sign | juce::jmin(half, (juce::uint32) 0x7bffu));
+    }
+
+    static float halfToFloat(juce::uint16 value) noexcept
+    {
+        auto sign = (juce::uint32) (value & 0x8000u) << 16;
+        auto exponentAndMantissa = (juce::uint32) (value & 0x7fffu);
+
+        // floatToHalf never produces denormals, so zero is the only special case
+        auto bits = exponentAndMantissa == 0 ? sign
+                                             : sign | ((exponentAndMantissa << 13) + ((127u - 15u) << 23));
+        float result;
+        std::memcpy(&result, &bits, sizeof(result));
+        return result;
+    }
+
+private:
+    juce::HeapBlock<float> nearBuffer;
+    int nearWritePos{ 0 };
+
+    std::vector<std::unique_ptr<juce::uint16[]>> blocks;
+    std::atomic<int> numCommittedBlocks{ 0 };
+    int maxBlocks{ 0 };
+
+    // audio thread only
+    int writePos{ 0 };
+    int activeLength{ 0 };
+    int writtenLength{ 0 };     // samples written since the last clear, never more than activeLength
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LongDelayLine)
+};
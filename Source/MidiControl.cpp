@@ -0,0 +1,151 @@
+/*
+  ==============================================================================
+
+    MidiControl.cpp
+
+  ==============================================================================
+*/
+
+#include "MidiControl.h"
+
+namespace
+{
+    // Length in beats selected by each note of the division octave, starting at C
+    constexpr float divisionBeats[12] =
+    {
+        4.0f,           // C   whole
+        2.0f,           // C#  half
+        3.0f,           // D   dotted half
+        1.0f,           // D#  quarter
+        1.5f,           // E   dotted quarter
+        2.0f / 3.0f,    // F   quarter triplet
+        0.5f,           // F#  eighth
+        0.75f,          // G   dotted eighth
+        1.0f / 3.0f,    // G#  eighth triplet
+        0.25f,          // A   sixteenth
+        0.375f,         // A#  dotted sixteenth
+        1.0f / 6.0f     // B   sixteenth triplet
+    };
+
+    // Taps further apart than this start a new tempo
+    constexpr double maxTapGap = 2.0;
+}
+
+//==============================================================================
+MidiControl::MidiControl()
+{
+    clearMappings();
+}
+
+void MidiControl::prepare(double sampleRate) noexcept
+{
+    currentSampleRate = sampleRate;
+    reset();
+}
+
+void MidiControl::reset() noexcept
+{
+    numEvents = 0;
+    blockStartSample = 0;
+    lastTapSample = -1;
+    numTaps = 0;
+    tappedBeatLength = 0.0;
+}
+
+void MidiControl::setMapping(int controller, int parameterIndex) noexcept
+{
+    if (juce::isPositiveAndBelow(controller, numControllers))
+        controllerMap[controller] = parameterIndex;
+}
+
+void MidiControl::clearMappings() noexcept
+{
+    for (auto& parameter : controllerMap)
+        parameter = unmapped;
+}
+
+int MidiControl::getMapping(int controller) const noexcept
+{
+    return juce::isPositiveAndBelow(controller, numControllers) ? controllerMap[controller].load()
+                                                                : unmapped;
+}
+
+//==============================================================================
+int MidiControl::collectEvents(const juce::MidiBuffer& midiMessages, int numSamples) noexcept
+{
+    numEvents = 0;
+    numDroppedEvents = 0;
+
+    for (const auto metadata : midiMessages)
+    {
+        // Read the raw bytes, building a juce::MidiMessage could allocate for sysex
+        if (metadata.numBytes < 3)
+            continue;
+
+        auto status = metadata.data[0] & 0xf0;
+        auto number = (int) metadata.data[1];
+        auto value = (int) metadata.data[2];
+        auto position = juce::jlimit(0, juce::jmax(0, numSamples - 1), metadata.samplePosition);
+
+        if (status == 0xb0)
+        {
+            auto learning = learningParameter.exchange(unmapped);
+
+            if (learning != unmapped)
+                controllerMap[number] = learning;
+
+            auto parameter = controllerMap[number].load();
+
+            if (parameter != unmapped)
+                addEvent(Event::Type::controller, position, parameter, (float) value / 127.0f);
+        }
+        else if (status == 0x90 && value > 0)
+        {
+            if (number == tapNote)
+                addEvent(Event::Type::tap, position, unmapped, registerTap(position));
+            else if (number >= divisionBaseNote && number < divisionBaseNote + 12)
+                addEvent(Event::Type::delayDivision, position, unmapped, divisionBeats[number - divisionBaseNote]);
+        }
+    }
+
+    blockStartSample += numSamples;
+    return numEvents;
+}
+
+void MidiControl::addEvent(Event::Type type, int samplePosition, int parameter, float value) noexcept
+{
+    if (numEvents >= maxEventsPerBlock)
+    {
+        ++numDroppedEvents;
+        return;
+    }
+
+    events[(size_t) numEvents++] = { type, samplePosition, parameter, value };
+}
+
+float MidiControl::registerTap(int samplePosition) noexcept
+{
+    auto now = blockStartSample + samplePosition;
+
+    if (lastTapSample >= 0 && now - lastTapSample <= static_cast<juce::int64>(maxTapGap * currentSampleRate))
+    {
+        tapIntervals[numTaps % numTapIntervals] = now - lastTapSample;
+        ++numTaps;
+
+        // average over the last few taps, so one sloppy tap doesn't throw the tempo
+        auto numIntervals = juce::jmin(numTaps, numTapIntervals);
+        juce::int64 total = 0;
+
+        for (int i = 0; i < numIntervals; ++i)
+            total += tapIntervals[i];
+
+        tappedBeatLength = (double) total / numIntervals / currentSampleRate;
+    }
+    else
+    {
+        numTaps = 0;
+    }
+
+    lastTapSample = now;
+    return static_cast<float>(tappedBeatLength);
+}
@@ -0,0 +1,90 @@
+/*
+  ==============================================================================
+
+    MidiControl.h
+
+    Turns incoming MIDI into control events for the processor: learned CC to
+    parameter mappings, notes selecting a tempo synced delay division and a
+    tap tempo note. Events keep their sample position so the processor can
+    split the block and apply each one exactly where it happened.
+
+    Everything the audio thread touches is preallocated, a busy MIDI lane
+    only ever costs the parsing.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+class MidiControl
+{
+public:
+    static constexpr int maxEventsPerBlock = 256;
+    static constexpr int numControllers = 128;
+    static constexpr int unmapped = -1;
+
+    struct Event
+    {
+        enum class Type { controller, delayDivision, tap };
+
+        Type type;
+        int samplePosition;
+        int parameter;      // controller events: the mapped parameter index
+        float value;        // controller: 0..1, division: length in beats, tap: beat length in seconds (0 until known)
+    };
+
+    MidiControl();
+
+    void prepare(double sampleRate) noexcept;
+    void reset() noexcept;
+
+    //==============================================================================
+    // CC learn. The next controller to arrive is bound to parameterIndex.
+    void learn(int parameterIndex) noexcept          { learningParameter = parameterIndex; }
+    void cancelLearn() noexcept                      { learningParameter = unmapped; }
+    bool isLearning() const noexcept                 { return learningParameter != unmapped; }
+
+    void setMapping(int controller, int parameterIndex) noexcept;
+    int getMapping(int controller) const noexcept;
+    void clearMappings() noexcept;
+
+    int tapNote { 24 };             // C0 taps the tempo
+    int divisionBaseNote { 48 };    // the octave from C2 picks the delay division
+
+    //==============================================================================
+    // Parses one block of MIDI into events sorted by sample position. Events past
+    // maxEventsPerBlock are dropped rather than allocating.
+    int collectEvents(const juce::MidiBuffer& midiMessages, int numSamples) noexcept;
+
+    const Event& getEvent(int index) const noexcept  { return events[(size_t) index]; }
+    int getNumDroppedEvents() const noexcept         { return numDroppedEvents; }
+
+    // Length of one beat in seconds from the last taps, or 0 until there have been two taps
+    double getTappedBeatLength() const noexcept      { return tappedBeatLength; }
+
+private:
+    //==============================================================================
+    void addEvent(Event::Type type, int samplePosition, int parameter, float value) noexcept;
+    float registerTap(int samplePosition) noexcept;
+
+    std::atomic<int> controllerMap[numControllers];
+    std::atomic<int> learningParameter{ unmapped };
+
+    std::array<Event, maxEventsPerBlock> events;
+    int numEvents{ 0 };
+    int numDroppedEvents{ 0 };
+
+    // Tap tempo, all in samples since prepare
+    double currentSampleRate{ 44100.0 };
+    juce::int64 blockStartSample{ 0 };
+    juce::int64 lastTapSample{ -1 };
+    static constexpr int numTapIntervals = 4;
+    juce::int64 tapIntervals[numTapIntervals]{};
+    int numTaps{ 0 };
+    double tappedBeatLength{ 0.0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiControl)
+};
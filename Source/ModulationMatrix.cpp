@@ -0,0 +1,299 @@
+/*
+  ==============================================================================
+
+    ModulationMatrix.cpp
+
+  ==============================================================================
+*/
+
+#include "ModulationMatrix.h"
+
+namespace
+{
+    float coefficientFor(float milliseconds, double controlRate) noexcept
+    {
+        auto steps = milliseconds / 1000.0 * controlRate;
+        return steps > 0.0 ? static_cast<float>(std::exp(-1.0 / steps)) : 0.0f;
+    }
+}
+
+//==============================================================================
+// Bipolar -1..1 shapes, starting from zero and rising
+ModulationMatrix::WaveTables::WaveTables()
+{
+    for (int i = 0; i <= tableSize; ++i)
+    {
+        auto phase = (float) i / (float) tableSize;
+        sine[(size_t) i] = std::sin(juce::MathConstants<float>::twoPi * phase);
+        triangle[(size_t) i] = phase < 0.25f ? 4.0f * phase
+                             : phase < 0.75f ? 2.0f - 4.0f * phase
+                                             : 4.0f * phase - 4.0f;
+    }
+}
+
+const ModulationMatrix::WaveTables& ModulationMatrix::getWaveTables()
+{
+    // 8 KB, built once per process by the first prepare
+    static const WaveTables tables;
+    return tables;
+}
+
+//==============================================================================
+void ModulationMatrix::prepare(double sampleRate, int maximumBlockSize)
+{
+    currentSampleRate = sampleRate;
+    maxBlockSize = juce::jmax(1, maximumBlockSize);
+    maxPoints = (maxBlockSize + controlInterval - 1) / controlInterval + 1;
+
+    waveTables = &getWaveTables();
+
+    sourcePoints.setSize(numSources, maxPoints + 1);
+    pointPositions.malloc((size_t) maxPoints);
+    destinationPoints.setSize(numDestinations, maxPoints + 1);
+    offsets.setSize(numDestinations, maxBlockSize);
+    values.setSize(numDestinations, maxBlockSize);
+
+    reset();
+}
+
+void ModulationMatrix::reset() noexcept
+{
+    std::fill(std::begin(lfoPhase), std::end(lfoPhase), 0.0f);
+    std::fill(std::begin(heldValue), std::end(heldValue), 0.0f);
+    std::fill(std::begin(envelopeValue), std::end(envelopeValue), 0.0f);
+    std::fill(std::begin(periodPeak), std::end(periodPeak), 0.0f);
+    random.setSeed(0x5a4d);    // sample and hold repeats exactly after every reset
+    periodPosition = 0;
+    blockStartPosition = 0;
+    sourcePoints.clear();
+    destinationPoints.clear();
+    offsets.clear();
+}
+
+void ModulationMatrix::setTable(const float* newValues, int numValues)
+{
+    if (newValues == nullptr || numValues <= 0)
+        return;
+
+    BAGS_RT_ASSERT_NOT_AUDIO_THREAD("ModulationMatrix::setTable on the audio thread");
+    const juce::SpinLock::ScopedLockType sl(tableLock);
+
+    // Linear resampling onto the table, wrapping round so the shape loops
+    for (int i = 0; i < tableSize; ++i)
+    {
+        auto position = (float) i * (float) numValues / (float) tableSize;
+        auto index = (int) position;
+        auto fraction = position - (float) index;
+        auto a = newValues[index % numValues];
+        auto b = newValues[(index + 1) % numValues];
+        pendingTable[(size_t) i] = a + fraction * (b - a);
+    }
+
+    pendingTable[tableSize] = pendingTable[0];
+    pendingTableChanged = true;
+}
+
+//==============================================================================
+void ModulationMatrix::process(const juce::AudioBuffer<float>& input, const juce::AudioBuffer<float>* sidechain,
+                               int startSample, int numSamples) noexcept
+{
+    jassert(numSamples <= maxBlockSize);
+    numSamples = juce::jmax(0, juce::jmin(numSamples, maxBlockSize));
+
+    // The periods keep their place even while nothing is routed, so the grid never moves
+    blockStartPosition = periodPosition;
+    periodPosition = (periodPosition + numSamples) % controlInterval;
+
+    std::fill(std::begin(modulated), std::end(modulated), false);
+
+    for (auto& route : routes)
+        if (route.enabled && route.depth != 0.0f)
+            modulated[(size_t) route.destination] = true;
+
+    if (std::none_of(std::begin(modulated), std::end(modulated), [] (bool m) { return m; }) || numSamples <= 0)
+        return;
+
+    // Pick up a new table if the message thread has one ready, without ever waiting for it
+    {
+        const juce::SpinLock::ScopedTryLockType sl(tableLock);
+
+        if (sl.isLocked() && pendingTableChanged)
+        {
+            userTable = pendingTable;
+            pendingTableChanged = false;
+        }
+    }
+
+    // A control point at the end of every period that finishes in this block
+    auto firstLength = controlInterval - blockStartPosition;
+    auto numPoints = numSamples < firstLength ? 0 : 1 + (numSamples - firstLength) / controlInterval;
+
+    for (int k = 0; k < numPoints; ++k)
+        pointPositions[k] = firstLength + k * controlInterval;
+
+    for (int lfo = 0; lfo < numLfos; ++lfo)
+        evaluateLfo(lfo, numPoints, sourcePoints.getWritePointer(lfo) + 2);
+
+    evaluateEnvelope(0, input, startSample, numSamples, pointPositions, numPoints,
+                     sourcePoints.getWritePointer(static_cast<int>(Source::envelope1)) + 2);
+    evaluateEnvelope(1, sidechain != nullptr ? *sidechain : input, startSample, numSamples, pointPositions, numPoints,
+                     sourcePoints.getWritePointer(static_cast<int>(Source::envelope2)) + 2);
+
+    for (int destination = 0; destination < numDestinations; ++destination)
+    {
+        if (! modulated[destination])
+            continue;
+
+        // Sum of every route onto this destination, at the control points
+        auto* points = destinationPoints.getWritePointer(destination);
+        juce::FloatVectorOperations::clear(points, numPoints + 2);
+
+        for (auto& route : routes)
+            if (route.enabled && static_cast<int>(route.destination) == destination)
+                juce::FloatVectorOperations::addWithMultiply(points,
+                                                             sourcePoints.getReadPointer(static_cast<int>(route.source)),
+                                                             route.depth, numPoints + 2);
+
+        // ..and every period ramps between the two points before it, so a ramp
+        // never needs a point from the future and the periods can be cut anywhere
+        auto* output = offsets.getWritePointer(destination);
+        auto start = 0;
+        auto position = blockStartPosition;
+
+        for (int k = 0; k <= numPoints; ++k)
+        {
+            auto end = k < numPoints ? pointPositions[k] : numSamples;
+            auto step = (points[k + 1] - points[k]) / (float) controlInterval;
+
+            for (int i = start; i < end; ++i)
+                output[i] = points[k] + step * (float) (position + i - start + 1);
+
+            start = end;
+            position = 0;
+        }
+    }
+
+    // The last two points carry over to the next block
+    for (int source = 0; source < numSources; ++source)
+    {
+        auto* points = sourcePoints.getWritePointer(source);
+        points[0] = points[numPoints];
+        points[1] = points[numPoints + 1];
+    }
+}
+
+const float* ModulationMatrix::getValues(Destination destination, float base, float maxValue, int offset, int numSamples) noexcept
+{
+    auto index = static_cast<int>(destination);
+
+    if (! modulated[index] || offset + numSamples > maxBlockSize)
+        return nullptr;
+
+    auto* output = values.getWritePointer(index, offset);
+    juce::FloatVectorOperations::fill(output, base, numSamples);
+    juce::FloatVectorOperations::addWithMultiply(output, offsets.getReadPointer(index, offset), maxValue, numSamples);
+    juce::FloatVectorOperations::clip(output, output, 0.0f, maxValue, numSamples);
+
+    return output;
+}
+
+float ModulationMatrix::getPeriodValue(Destination destination, float base, float maxValue, int offset) const noexcept
+{
+    auto index = static_cast<int>(destination);
+
+    if (! modulated[index])
+        return base;
+
+    return juce::jlimit(0.0f, maxValue, base + maxValue * destinationPoints.getSample(index, getPeriodIndex(offset)));
+}
+
+int ModulationMatrix::getSamplesToNextControlPoint(int offset) const noexcept
+{
+    return controlInterval - (blockStartPosition + offset) % controlInterval;
+}
+
+int ModulationMatrix::getPeriodIndex(int offset) const noexcept
+{
+    return (blockStartPosition + offset) / controlInterval;
+}
+
+//==============================================================================
+void ModulationMatrix::evaluateLfo(int lfo, int numPoints, float* output) noexcept
+{
+    auto& settings = lfos[lfo];
+    auto increment = settings.rate * (float) controlInterval / (float) currentSampleRate;
+    auto& phase = lfoPhase[lfo];
+
+    if (settings.shape == Shape::sampleAndHold)
+    {
+        // A new random level every cycle
+        for (int k = 0; k < numPoints; ++k)
+        {
+            phase += increment;
+
+            if (phase >= 1.0f)
+            {
+                phase -= std::floor(phase);
+                heldValue[lfo] = 2.0f * random.nextFloat() - 1.0f;
+            }
+
+            output[k] = heldValue[lfo];
+        }
+    }
+    else
+    {
+        auto& table = settings.shape == Shape::sine     ? waveTables->sine
+                    : settings.shape == Shape::triangle ? waveTables->triangle
+                                                        : userTable;
+
+        // Phases first, then the lookups, both straight loops over the control points. The phase
+        // steps one period at a time, so it rounds the same however the points fall into blocks.
+        for (int k = 0; k < numPoints; ++k)
+        {
+            phase += increment;
+            phase -= std::floor(phase);
+            output[k] = phase * (float) tableSize;
+        }
+
+        for (int k = 0; k < numPoints; ++k)
+        {
+            auto index = juce::jmin((int) output[k], tableSize - 1);
+            auto fraction = output[k] - (float) index;
+            output[k] = table[(size_t) index] + fraction * (table[(size_t) index + 1] - table[(size_t) index]);
+        }
+    }
+}
+
+void ModulationMatrix::evaluateEnvelope(int envelope, const juce::AudioBuffer<float>& source, int startSample,
+                                        int numSamples, const int* positions, int numPoints, float* output) noexcept
+{
+    auto controlRate = currentSampleRate / controlInterval;
+    auto attackCoefficient = coefficientFor(envelopes[envelope].attack, controlRate);
+    auto releaseCoefficient = coefficientFor(envelopes[envelope].release, controlRate);
+    auto& value = envelopeValue[envelope];
+    auto& peak = periodPeak[envelope];
+    auto start = 0;
+
+    // Every period's peak, the last one may have started in an earlier block and
+    // whatever is left after the last point carries over to the next
+    for (int k = 0; k <= numPoints; ++k)
+    {
+        auto end = k < numPoints ? positions[k] : numSamples;
+
+        for (int channel = 0; channel < source.getNumChannels() && end > start; ++channel)
+        {
+            auto range = juce::FloatVectorOperations::findMinAndMax(source.getReadPointer(channel, startSample + start), end - start);
+            peak = juce::jmax(peak, -range.getStart(), range.getEnd());
+        }
+
+        start = end;
+
+        if (k == numPoints)
+            break;
+
+        auto coefficient = peak > value ? attackCoefficient : releaseCoefficient;
+        value = peak + coefficient * (value - peak);
+        output[k] = juce::jmin(value, 1.0f);
+        peak = 0.0f;
+    }
+}
@@ -0,0 +1,143 @@
+/*
+  ==============================================================================
+
+    ModulationMatrix.h
+
+    LFOs and envelope followers routed onto the delay and reverb parameters.
+    Sources are only evaluated once every controlInterval samples (the LFOs
+    as a batch of wavetable lookups), each destination is then ramped
+    linearly between its control points over the period after, so the
+    kernels just read one more value per sample. Like the sidechain ducker,
+    periods run on across process calls, so the modulation doesn't depend
+    on the host block size or where MIDI events split it.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "RealtimeSafetyChecker.h"
+
+//==============================================================================
+class ModulationMatrix
+{
+public:
+    static constexpr int controlInterval = 32;
+    static constexpr int numLfos = 4;
+    static constexpr int numEnvelopes = 2;
+    static constexpr int maxRoutes = 8;
+    static constexpr int tableSize = 1024;
+
+    // envelope1 follows the main input, envelope2 the sidechain (or the input when there is none)
+    enum class Source { lfo1, lfo2, lfo3, lfo4, envelope1, envelope2, numSources };
+    enum class Destination { delayTime, delayLevel, roomSize, damp, width, wetLevel, dryLevel, numDestinations };
+
+    enum class Shape { sine, triangle, sampleAndHold, table };
+
+    struct Lfo
+    {
+        Shape shape { Shape::sine };
+        float rate { 1.0f };        // Hz
+    };
+
+    struct Envelope
+    {
+        float attack { 10.0f };     // milliseconds
+        float release { 200.0f };   // milliseconds
+    };
+
+    // depth is in units of the destination's full range, negative depths invert
+    struct Route
+    {
+        bool enabled { false };
+        Source source { Source::lfo1 };
+        Destination destination { Destination::delayTime };
+        float depth { 0.0f };
+    };
+
+    Lfo lfos[numLfos];
+    Envelope envelopes[numEnvelopes];
+    Route routes[maxRoutes];
+
+    ModulationMatrix() = default;
+
+    void prepare(double sampleRate, int maximumBlockSize);
+    void reset() noexcept;
+
+    // Loads the shape used by Shape::table, resampled to tableSize points. Message thread only.
+    void setTable(const float* values, int numValues);
+
+    //==============================================================================
+    // Advances every source by numSamples (starting at startSample) and builds the
+    // destination ramps. sidechain may be nullptr. numSamples must not exceed the
+    // prepared block size.
+    void process(const juce::AudioBuffer<float>& input, const juce::AudioBuffer<float>* sidechain,
+                 int startSample, int numSamples) noexcept;
+
+    bool isModulated(Destination destination) const noexcept  { return modulated[(size_t) destination]; }
+
+    // Writes base + the modulation (scaled to maxValue) for numSamples of the last
+    // processed block, starting at offset, clipped to 0..maxValue. Returns nullptr
+    // when nothing is routed to the destination.
+    const float* getValues(Destination destination, float base, float maxValue, int offset, int numSamples) noexcept;
+
+    // For destinations that only take one value per control period: the value the ramp
+    // starts the period holding offset from, and how far that period runs on from offset
+    float getPeriodValue(Destination destination, float base, float maxValue, int offset) const noexcept;
+    int getSamplesToNextControlPoint(int offset) const noexcept;
+
+private:
+    //==============================================================================
+    using WaveTable = std::array<float, tableSize + 1>;   // one guard point for the interpolation
+
+    struct WaveTables
+    {
+        WaveTables();
+        WaveTable sine, triangle;
+    };
+
+    static const WaveTables& getWaveTables();
+
+    void evaluateLfo(int lfo, int numPoints, float* output) noexcept;
+    void evaluateEnvelope(int envelope, const juce::AudioBuffer<float>& source, int startSample,
+                          int numSamples, const int* positions, int numPoints, float* output) noexcept;
+    int getPeriodIndex(int offset) const noexcept;
+
+    static constexpr int numSources = static_cast<int>(Source::numSources);
+    static constexpr int numDestinations = static_cast<int>(Destination::numDestinations);
+
+    double currentSampleRate{ 44100.0 };
+    int maxBlockSize{ 0 };
+    int maxPoints{ 0 };
+
+    const WaveTables* waveTables{ nullptr };
+
+    juce::SpinLock tableLock;
+    WaveTable pendingTable{};           // written by setTable
+    bool pendingTableChanged{ false };
+    WaveTable userTable{};              // the audio thread's copy
+
+    float lfoPhase[numLfos]{};
+    float heldValue[numLfos]{};         // sample and hold output
+    juce::Random random;
+
+    float envelopeValue[numEnvelopes]{};
+    float periodPeak[numEnvelopes]{};
+
+    // The period in progress, carried over between calls, and where the last block started in its period
+    int periodPosition{ 0 };
+    int blockStartPosition{ 0 };
+
+    // Control points per source. 0 and 1 are the last two from before the block (the ramp
+    // in progress runs between them), the points from periods ending in the block follow.
+    juce::AudioBuffer<float> sourcePoints;
+    juce::HeapBlock<int> pointPositions;
+    juce::AudioBuffer<float> destinationPoints;
+
+    juce::AudioBuffer<float> offsets;   // per sample modulation for each destination, -1..1
+    juce::AudioBuffer<float> values;    // scratch for getValues
+    bool modulated[numDestinations]{};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ModulationMatrix)
+};
@@ -21,9 +21,56 @@ BagsComboAudioProcessorEditor::BagsComboAudioProcessorEditor(BagsComboAudioProce
     delayLevelController.setRange(0.0, 1.0, 0.01);
     delayLevelController.setValue(0.25);
 
-    delayTimeController.setRange(0.0, 1000.0, 1.0);
+    delayTimeController.setRange(0.0, audioProcessor.longDelayMode ? BagsComboAudioProcessor::maxLongDelayTime
+                                                                    : BagsComboAudioProcessor::maxDelayTime, 1.0);
     delayTimeController.showTextBox();
 
+    // Looper style delay times, the time dial's range follows the mode
+    longDelayButton.setToggleState(audioProcessor.longDelayMode, juce::dontSendNotification);
+    longDelayButton.onClick = [this]
+    {
+        auto longDelay = longDelayButton.getToggleState();
+        audioProcessor.setLongDelayMode(longDelay);
+        delayTimeController.setRange(0.0, longDelay ? BagsComboAudioProcessor::maxLongDelayTime
+                                                    : BagsComboAudioProcessor::maxDelayTime, 1.0);
+    };
+
+    // Holds both tails, which makes the tail length infinite for the host
+    freezeButton.setToggleState(audioProcessor.freeze, juce::dontSendNotification);
+    freezeButton.onClick = [this]
+    {
+        audioProcessor.freeze = freezeButton.getToggleState();
+        audioProcessor.updateHostDisplay();
+    };
+
+    // Stereo delay, cross feeds the echoes over to the other side (all the way is ping-pong)
+    stereoDelayButton.setToggleState(audioProcessor.delayMode == BagsComboAudioProcessor::DelayMode::stereo, juce::dontSendNotification);
+    stereoDelayButton.onClick = [this]
+    {
+        audioProcessor.delayTimeRight = audioProcessor.delayTime;
+        audioProcessor.delayMode = stereoDelayButton.getToggleState() ? BagsComboAudioProcessor::DelayMode::stereo
+                                                                      : BagsComboAudioProcessor::DelayMode::classic;
+    };
+
+    // Tape character in the classic delay's feedback loop
+    tapeButton.setToggleState(audioProcessor.tapeMode, juce::dontSendNotification);
+    tapeButton.onClick = [this] { audioProcessor.tapeMode = tapeButton.getToggleState(); };
+
+    // Sidechain ducking of the delay and reverb returns
+    duckingButton.setToggleState(audioProcessor.duckingEnabled, juce::dontSendNotification);
+    duckingButton.onClick = [this] { audioProcessor.duckingEnabled = duckingButton.getToggleState(); };
+
+    // Host bypass cuts the tails instead of letting them ring out
+    cutOnBypassButton.setToggleState(audioProcessor.bypassMode == BagsComboAudioProcessor::BypassMode::cut, juce::dontSendNotification);
+    cutOnBypassButton.onClick = [this]
+    {
+        audioProcessor.bypassMode = cutOnBypassButton.getToggleState() ? BagsComboAudioProcessor::BypassMode::cut
+                                                                       : BagsComboAudioProcessor::BypassMode::ringOut;
+    };
+
+    crossFeedbackController.setRange(0.0, 1.0, 0.05);
+    crossFeedbackController.setValue(audioProcessor.crossFeedback);
+
     roomSizeController.setRange(0.0, 1.0, 0.05);
     roomSizeController.setValue(0.5);
 
@@ -39,18 +86,69 @@ BagsComboAudioProcessorEditor::BagsComboAudioProcessorEditor(BagsComboAudioProce
     dryLevelController.setRange(0.0, 1.0, 0.05);
     dryLevelController.setValue(0.4);
 
+    // Reverb algorithm, ids follow BagsComboAudioProcessor::ReverbAlgorithm
+    reverbAlgorithmBox.addItem("freeverb", 1);
+    reverbAlgorithmBox.addItem("fdn", 2);
+    reverbAlgorithmBox.setSelectedId(static_cast<int>(audioProcessor.reverbAlgorithm) + 1, juce::dontSendNotification);
+    reverbAlgorithmBox.onChange = [this]
+    {
+        audioProcessor.reverbAlgorithm = static_cast<BagsComboAudioProcessor::ReverbAlgorithm>(reverbAlgorithmBox.getSelectedId() - 1);
+    };
+
+    // Rate the late reverb runs at, ids follow BagsComboAudioProcessor::ReverbQuality
+    reverbQualityBox.addItem("full", 1);
+    reverbQualityBox.addItem("half", 2);
+    reverbQualityBox.addItem("quarter", 3);
+    reverbQualityBox.setSelectedId(static_cast<int>(audioProcessor.reverbQuality) + 1, juce::dontSendNotification);
+    reverbQualityBox.onChange = [this]
+    {
+        audioProcessor.reverbQuality = static_cast<BagsComboAudioProcessor::ReverbQuality>(reverbQualityBox.getSelectedId() - 1);
+    };
+
     // Define the parameters of gainController slider
     gainController.setRange(0.0, 1.0, 0.01);
     gainController.setSliderStyle(juce::Slider::SliderStyle::Rotary);
 
+    // MIDI learn: pick a parameter, then move a controller
+    midiLearnBox.setTextWhenNothingSelected("MIDI learn");
+    midiLearnBox.onOpen = [this] { updateMidiLearnItems(); };
+    midiLearnBox.onChange = [this]
+    {
+        auto& midiControl = audioProcessor.getMidiControl();
+        auto id = midiLearnBox.getSelectedId();
+        midiLearnBox.setSelectedId(0, juce::dontSendNotification);
+
+        if (id == cancelLearnId)
+        {
+            midiControl.cancelLearn();
+        }
+        else if (id == forgetAllId)
+        {
+            midiControl.clearMappings();
+        }
+        else if (id > 0)
+        {
+            midiControl.learn(id - 1);
+            midiLearnBox.setTextWhenNothingSelected("move a controller..");
+            startTimer(100);
+        }
+    };
+
 
    // Add controllers and make visible 
     addAndMakeVisible(gainController);
+    addAndMakeVisible(midiLearnBox);
 
     addAndMakeVisible(delayLevelController);
     addAndMakeVisible(delayTimeController);
+    addAndMakeVisible(longDelayButton);
+    addAndMakeVisible(freezeButton);
+    addAndMakeVisible(crossFeedbackController);
+    addAndMakeVisible(stereoDelayButton);
+    addAndMakeVisible(tapeButton);
+    addAndMakeVisible(duckingButton);
+    addAndMakeVisible(cutOnBypassButton);
     //addAndMakeVisible(d3);
-    //addAndMakeVisible(d4);
     //addAndMakeVisible(d5);
     //addAndMakeVisible(d6);
 
@@ -60,10 +158,13 @@ BagsComboAudioProcessorEditor::BagsComboAudioProcessorEditor(BagsComboAudioProce
     addAndMakeVisible(wetLevelController);
     addAndMakeVisible(dryLevelController);
     //addAndMakeVisible(r6);
+    addAndMakeVisible(reverbAlgorithmBox);
+    addAndMakeVisible(reverbQualityBox);
     
     // Add listeners to the sliders
     delayLevelController.addListener(this);
     delayTimeController.addListener(this);
+    crossFeedbackController.addListener(this);
     
     roomSizeController.addListener(this);
     widthController.addListener(this);
@@ -77,12 +178,15 @@ BagsComboAudioProcessorEditor::BagsComboAudioProcessorEditor(BagsComboAudioProce
 
 BagsComboAudioProcessorEditor::~BagsComboAudioProcessorEditor()
 {
+    // Nobody would know what a learn left running ends up binding
+    audioProcessor.getMidiControl().cancelLearn();
+
     // Reset look and feel when plugin closes
     gainController.setLookAndFeel(nullptr); 
     delayLevelController.setLookAndFeel(nullptr);
     delayTimeController.setLookAndFeel(nullptr);
     d3.setLookAndFeel(nullptr);
-    d4.setLookAndFeel(nullptr);
+    crossFeedbackController.setLookAndFeel(nullptr);
     d5.setLookAndFeel(nullptr);
     d6.setLookAndFeel(nullptr);
 
@@ -137,10 +241,22 @@ void BagsComboAudioProcessorEditor::resized()
     delayLevelController.setBounds(border, border + headerHeight, dialWidth, dialHeight);
     delayTimeController.setBounds(border + dialWidth + padding, border + headerHeight, dialWidth, dialHeight);
     d3.setBounds(border + 2 * (dialWidth + padding), border + headerHeight, dialWidth, dialHeight);
-    d4.setBounds(border, border + headerHeight + dialHeight + 4*padding, dialWidth, dialHeight);
+    auto modeSlot = d3.getBounds();
+    longDelayButton.setBounds(modeSlot.removeFromTop(dialHeight / 2));
+    freezeButton.setBounds(modeSlot);
+    crossFeedbackController.setBounds(border, border + headerHeight + dialHeight + 4*padding, dialWidth, dialHeight);
     d5.setBounds(border + dialWidth + padding, border + headerHeight + dialHeight + 4*padding, dialWidth, dialHeight);
     d6.setBounds(border + 2 * (dialWidth + padding), border + headerHeight + dialHeight + 4*padding, dialWidth, dialHeight);
 
+    // The delay switches share the d5 slot
+    auto delaySlot = d5.getBounds();
+    stereoDelayButton.setBounds(delaySlot.removeFromTop(dialHeight / 2));
+    tapeButton.setBounds(delaySlot);
+
+    auto switchSlot = d6.getBounds();
+    duckingButton.setBounds(switchSlot.removeFromTop(dialHeight / 2));
+    cutOnBypassButton.setBounds(switchSlot);
+
     // Arrange reverb controllers in 3 by 2 grid on the right
     const int rightBorder = getWidth() / 2 + border;
     roomSizeController.setBounds(rightBorder, border + headerHeight, dialWidth, dialHeight);
@@ -150,8 +266,16 @@ void BagsComboAudioProcessorEditor::resized()
     dryLevelController.setBounds(rightBorder + dialWidth + padding, border + headerHeight + dialHeight + 4*padding, dialWidth, dialHeight);
     r6.setBounds(rightBorder + 2 * (dialWidth + padding), border + headerHeight + dialHeight + 4*padding, dialWidth, dialHeight);
 
+    // The reverb selectors share the r6 slot
+    auto reverbSlot = r6.getBounds();
+    reverbAlgorithmBox.setBounds(reverbSlot.removeFromTop(dialHeight / 2));
+    reverbQualityBox.setBounds(reverbSlot);
+
     // Arrange gain controller below the grid in the center
     gainController.setBounds((getWidth() - dialWidth) / 2, getHeight() - border - dialHeight, dialWidth, dialHeight);
+
+    // MIDI learn in the bottom left corner
+    midiLearnBox.setBounds(border, getHeight() - border - 20, 3 * dialWidth, 20);
 }
 
 
@@ -159,6 +283,8 @@ void BagsComboAudioProcessorEditor::sliderValueChanged(juce::Slider* slider)
 {
     audioProcessor.delayLevel = static_cast<float>(delayLevelController.getValue());
     audioProcessor.delayTime = static_cast<float>(delayTimeController.getValue());
+    audioProcessor.delayTimeRight = audioProcessor.delayTime;   // one time dial for both sides, like the tempo sync
+    audioProcessor.crossFeedback = static_cast<float>(crossFeedbackController.getValue());
     
     audioProcessor.roomSize = static_cast<float>(roomSizeController.getValue());
     audioProcessor.width = static_cast<float>(widthController.getValue());
@@ -167,7 +293,42 @@ void BagsComboAudioProcessorEditor::sliderValueChanged(juce::Slider* slider)
     audioProcessor.dryLevel = static_cast<float>(dryLevelController.getValue());
 
     audioProcessor.gainLevel = static_cast<float>(gainController.getValue());
-    
+
+    if (slider == &delayTimeController)
+        audioProcessor.updateLongDelayStorage();
 }
 
+void BagsComboAudioProcessorEditor::timerCallback()
+{
+    // The audio thread ends the learn when the controller arrives
+    if (audioProcessor.getMidiControl().isLearning())
+        return;
 
+    stopTimer();
+    midiLearnBox.setTextWhenNothingSelected("MIDI learn");
+}
+
+void BagsComboAudioProcessorEditor::updateMidiLearnItems()
+{
+    using Parameter = BagsComboAudioProcessor::Parameter;
+    auto& midiControl = audioProcessor.getMidiControl();
+
+    midiLearnBox.clear(juce::dontSendNotification);
+
+    if (midiControl.isLearning())
+        midiLearnBox.addItem("cancel learn", cancelLearnId);
+
+    for (int index = 0; index < static_cast<int>(Parameter::numParameters); ++index)
+    {
+        auto name = BagsComboAudioProcessor::getParameterName(static_cast<Parameter>(index));
+
+        for (int controller = 0; controller < MidiControl::numControllers; ++controller)
+            if (midiControl.getMapping(controller) == index)
+                name << "  (CC " << controller << ")";
+
+        midiLearnBox.addItem(name, index + 1);
+    }
+
+    midiLearnBox.addSeparator();
+    midiLearnBox.addItem("forget all CCs", forgetAllId);
+}
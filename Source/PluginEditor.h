@@ -103,7 +103,22 @@ private:
     juce::Label label;
 };
 
-class BagsComboAudioProcessorEditor  : public juce::AudioProcessorEditor, private juce::Slider::Listener // [2]
+// Picks the parameter the next MIDI CC gets bound to. The list is rebuilt every
+// time it opens, so it always shows the current mappings.
+class MidiLearnBox : public juce::ComboBox {
+public:
+    std::function<void()> onOpen;
+
+    void showPopup() override
+    {
+        if (onOpen)
+            onOpen();
+
+        juce::ComboBox::showPopup();
+    }
+};
+
+class BagsComboAudioProcessorEditor  : public juce::AudioProcessorEditor, private juce::Slider::Listener, private juce::Timer // [2]
 {
 public:
     BagsComboAudioProcessorEditor (BagsComboAudioProcessor&);
@@ -114,6 +129,8 @@ public:
     void resized() override;
 private:
     void sliderValueChanged(juce::Slider* slider) override;
+    void timerCallback() override;
+    void updateMidiLearnItems();
 
     BagsComboAudioProcessor& audioProcessor;
     DelayLookAndFeel delayLookAndFeel;
@@ -122,9 +139,15 @@ private:
     CustomController delayLevelController{"level", &delayLookAndFeel};
     CustomController delayTimeController {"time", & delayLookAndFeel};
     CustomController d3 {"d3", &delayLookAndFeel };
-    CustomController d4 {"d4", &delayLookAndFeel };
+    juce::ToggleButton longDelayButton {"long"};
+    juce::ToggleButton freezeButton {"freeze"};
+    CustomController crossFeedbackController {"cross", &delayLookAndFeel };
     CustomController d5 {"d5", &delayLookAndFeel };
+    juce::ToggleButton stereoDelayButton {"stereo"};
+    juce::ToggleButton tapeButton {"tape"};
     CustomController d6 {"d6", &delayLookAndFeel };
+    juce::ToggleButton duckingButton {"duck"};
+    juce::ToggleButton cutOnBypassButton {"cut"};
                          
     CustomController roomSizeController {"size", &reverbLookAndFeel };
     CustomController dampController {"damp", &reverbLookAndFeel };
@@ -132,9 +155,15 @@ private:
     CustomController wetLevelController {"wet", &reverbLookAndFeel };
     CustomController dryLevelController {"dry", &reverbLookAndFeel };
     CustomController r6 {"r6", &reverbLookAndFeel };
+    juce::ComboBox reverbAlgorithmBox;
+    juce::ComboBox reverbQualityBox;
                         
     CustomController gainController {"gain", &reverbLookAndFeel};
 
+    MidiLearnBox midiLearnBox;
+    static constexpr int cancelLearnId { 1000 };
+    static constexpr int forgetAllId { 1001 };
+
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BagsComboAudioProcessorEditor)
 };
\ No newline at end of file
@@ -9,6 +9,25 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 
+namespace
+{
+    // Linear interpolated read delaySamples behind writePos, for swept delay times.
+    // stride steps over interleaved channels.
+    inline float readInterpolated(const float* data, int length, int stride, int writePos, float delaySamples) noexcept
+    {
+        auto readPos = (float) writePos - juce::jlimit(0.0f, (float) (length - 1), delaySamples);
+
+        if (readPos < 0.0f)
+            readPos += (float) length;
+
+        auto index = juce::jmin(static_cast<int>(readPos), length - 1);
+        auto next = index + 1 < length ? index + 1 : 0;
+        auto a = data[index * stride];
+
+        return a + (readPos - (float) index) * (data[next * stride] - a);
+    }
+}
+
 //==============================================================================
 BagsComboAudioProcessor::BagsComboAudioProcessor()
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -16,16 +35,27 @@ BagsComboAudioProcessor::BagsComboAudioProcessor()
                      #if ! JucePlugin_IsMidiEffect
                       #if ! JucePlugin_IsSynth
                        .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
+                       .withInput  ("Sidechain", juce::AudioChannelSet::stereo(), false)
                       #endif
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
                      #endif
                        )
 #endif
 {
+    addParameter(mCpuLoadParameter = new juce::AudioParameterFloat(juce::ParameterID { "cpuLoad", 1 }, "CPU Load",
+                                                                   juce::NormalisableRange<float>(0.0f, 100.0f), 0.0f,
+                                                                   juce::AudioParameterFloatAttributes()
+                                                                       .withLabel("%")
+                                                                       .withCategory(juce::AudioProcessorParameter::otherMeter)
+                                                                       .withAutomatable(false)));
+
+    // Long delay storage follows the delay time from the message thread, the CPU meter follows the load
+    startTimer(100);
 }
 
 BagsComboAudioProcessor::~BagsComboAudioProcessor()
 {
+    stopTimer();
 }
 
 //==============================================================================
@@ -63,7 +93,32 @@ bool BagsComboAudioProcessor::isMidiEffect() const
 
 double BagsComboAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    // Frozen, or with the echoes fed back at full level, nothing decays
+    if (freeze || delayLevel >= 1.0f)
+        return std::numeric_limits<double>::infinity();
+
+    // Every echo is delayLevel times the one before, count them down to -60 dB
+    auto longestDelay = juce::jmax(delayTime, delayMode == DelayMode::stereo ? delayTimeRight : 0.0f) / 1000.0;
+    auto delayDecay = 0.0;
+
+    if (delayLevel > 0.0f)
+        delayDecay = longestDelay * (1.0 + std::log(0.001) / std::log((double) delayLevel));
+
+    // The reverb keeps ringing after the last echo. Freeverb's longest comb is 1617 samples
+    // at 44.1 kHz with a feedback of 0.7 up to 0.98, damping only shortens that.
+    auto reverbDecay = 0.0;
+
+    if (reverbAlgorithm == ReverbAlgorithm::fdn)
+    {
+        reverbDecay = FdnReverb::getDecayTime(roomSize);
+    }
+    else
+    {
+        auto combFeedback = juce::jlimit(0.0, 0.98, roomSize * 0.28 + 0.7);
+        reverbDecay = 1617.0 / 44100.0 * std::log(0.001) / std::log(combFeedback);
+    }
+
+    return delayDecay + preDelay / 1000.0 + reverbDecay;
 }
 
 int BagsComboAudioProcessor::getNumPrograms()
@@ -93,14 +148,217 @@ void BagsComboAudioProcessor::changeProgramName (int index, const juce::String&
 //==============================================================================
 void BagsComboAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
+    mSampleRate = static_cast<int>(sampleRate);
+    mMaxBlockSize = samplesPerBlock;
+
+    // Best instruction set variant of the inner loops for this CPU, picked once
+    mKernels = forceScalarKernels ? &DspKernels::getScalar() : &DspKernels::select();
+
+    mLoadMeasurer.reset(sampleRate, samplesPerBlock);
+    mBypassDryBuffer.setSize(2, samplesPerBlock);
+    mBypassTailFinished = false;
+    mBypassSilentSamples = 0;
+    mTailsCut = false;
+    mTailClearPosition = -1;
+
+    mMidiControl.prepare(sampleRate);
+    mDucker.prepare(sampleRate, samplesPerBlock);
+    mModulationMatrix.prepare(sampleRate, samplesPerBlock);
+    mTapeFeedback.prepare(sampleRate, samplesPerBlock);
+    mDiffuser.prepare(sampleRate);
+    mDiffuserActive = false;
+    mTapeBuffer.setSize(2, samplesPerBlock);
+    mTapeFeedback.setKernels(*mKernels);
+
     mDelayBuffer.setSize(2, 2*mSampleRate);
     mDelayBuffer.clear();
+
+    mStereoDelayLength = 2*mSampleRate;
+    mStereoDelayBuffer.calloc(2 * (size_t) mStereoDelayLength);
+    mStereoDelayPosition = 0;
+
+    earlyReflections.prepare(sampleRate, samplesPerBlock);
+
+    reverb.setSampleRate(sampleRate);
+    fdnReverb.setSampleRate(sampleRate);
+    fdnReverb.setKernels(*mKernels);
+
+    mReducedRateProcessor.prepare(samplesPerBlock);
+    mReverbWetBuffer.setSize(2, samplesPerBlock);
+
+    for (int stage = 0; stage < ReducedRateProcessor::maxStages; ++stage)
+    {
+        mReducedRateReverbs[stage].setSampleRate(sampleRate / (2 << stage));
+        mReducedRateFdnReverbs[stage].setSampleRate(sampleRate / (2 << stage));
+        mReducedRateFdnReverbs[stage].setKernels(*mKernels);
+    }
+
+    mActiveReverbQuality = reverbQuality;
+    mActiveReverbAlgorithm = reverbAlgorithm;
+
+    // Long delay storage only commits what the current delay time needs
+    const juce::ScopedLock storageLock(mLongDelayStorageLock);
+
+    for (auto& line : mLongDelayLines)
+        line.prepare(sampleRate, maxLongDelayTime / 1000.0);
+
+    mRequestedLongDelaySamples = 0;
+    mLongDelayState = longDelayIdle;
+    mLongDelayLinesHeld = false;
+    updateLongDelayStorage();
 }
 
 void BagsComboAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+    const juce::ScopedLock storageLock(mLongDelayStorageLock);
+
+    for (auto& line : mLongDelayLines)
+        line.release();
+}
+
+void BagsComboAudioProcessor::reset()
+{
+    // Only clears what prepareToPlay allocated, so hosts may call this from the audio thread
+    clearTails();
+
+    mDucker.reset();
+    mModulationMatrix.reset();
+    mMidiControl.reset();
+}
+
+void BagsComboAudioProcessor::clearTails() noexcept
+{
+    mTailClearPosition = 0;
+    continueClearingTails(std::numeric_limits<int>::max());
+}
+
+bool BagsComboAudioProcessor::continueClearingTails(int maxSamples) noexcept
+{
+    if (mTailClearPosition < 0)
+        return true;
+
+    if (mTailClearPosition == 0)
+        clearSmallTails();
+
+    // The delay buffer's channels and then the interleaved stereo ring, as one run of samples
+    auto delayLength = mDelayBuffer.getNumSamples();
+    auto delaySamples = delayLength * mDelayBuffer.getNumChannels();
+    auto stereoSamples = mStereoDelayBuffer != nullptr ? 2 * mStereoDelayLength : 0;
+    auto total = delaySamples + stereoSamples;
+    auto end = mTailClearPosition + juce::jmin(maxSamples, total - mTailClearPosition);
+
+    while (mTailClearPosition < end)
+    {
+        if (mTailClearPosition < delaySamples)
+        {
+            auto channel = mTailClearPosition / delayLength;
+            auto start = mTailClearPosition % delayLength;
+            auto length = juce::jmin(delayLength - start, end - mTailClearPosition);
+            mDelayBuffer.clear(channel, start, length);
+            mTailClearPosition += length;
+        }
+        else
+        {
+            auto start = mTailClearPosition - delaySamples;
+            juce::FloatVectorOperations::clear(mStereoDelayBuffer + start, end - mTailClearPosition);
+            mTailClearPosition = end;
+        }
+    }
+
+    if (mTailClearPosition < total)
+        return false;
+
+    mTailClearPosition = -1;
+    return true;
+}
+
+void BagsComboAudioProcessor::clearSmallTails() noexcept
+{
+    mDelayPosition = 0;
+    mStereoDelayPosition = 0;
+
+    // While the timer is freeing the long lines it silences them itself
+    if (acquireLongDelayLines())
+        for (auto& line : mLongDelayLines)
+            line.clear();
+
+    mTapeFeedback.reset();
+    mDiffuser.reset();
+    earlyReflections.reset();
+    fdnReverb.reset();
+    mReducedRateProcessor.reset();
+
+    for (auto& lowRateFdnReverb : mReducedRateFdnReverbs)
+        lowRateFdnReverb.reset();
+
+    // juce::Reverb::reset() leaves its gain smoothers mid ramp. Setting the same rate
+    // again clears the filters and snaps the smoothers, and doesn't reallocate.
+    auto sampleRate = getSampleRate();
+
+    if (sampleRate <= 0.0)
+        return;     // never prepared, so nothing has rung yet
+
+    reverb.setSampleRate(sampleRate);
+
+    for (int stage = 0; stage < ReducedRateProcessor::maxStages; ++stage)
+        mReducedRateReverbs[stage].setSampleRate(sampleRate / (2 << stage));
+}
+
+void BagsComboAudioProcessor::updateLongDelayStorage()
+{
+    const juce::ScopedLock storageLock(mLongDelayStorageLock);
+
+    if (! longDelayMode)
+    {
+        // Hand the storage back once the audio thread has stopped using it
+        auto expected = static_cast<int>(longDelayIdle);
+
+        if (mLongDelayLines[0].hasCommittedBlocks() && mLongDelayState.compare_exchange_strong(expected, longDelayShrinking))
+        {
+            for (auto& line : mLongDelayLines)
+                line.decommit();
+
+            mRequestedLongDelaySamples = 0;
+            mLongDelayState = longDelayIdle;
+        }
+
+        return;
+    }
+
+    requestLongDelayStorage(static_cast<int>(juce::jmin(delayTime, maxLongDelayTime) / 1000 * mSampleRate) + 1);
+
+    // commit() only ever adds blocks, so a smaller request is a no-op
+    for (auto& line : mLongDelayLines)
+        line.commit(mRequestedLongDelaySamples.load());
+}
+
+void BagsComboAudioProcessor::setLongDelayMode(bool shouldUseLongDelay)
+{
+    setParameterNormalised(Parameter::longDelayMode, shouldUseLongDelay ? 1.0f : 0.0f);
+    updateLongDelayStorage();
+}
+
+void BagsComboAudioProcessor::timerCallback()
+{
+    updateLongDelayStorage();
+    *mCpuLoadParameter = static_cast<float>(juce::jmin(100.0, getCpuLoad()));
+}
+
+bool BagsComboAudioProcessor::acquireLongDelayLines() noexcept
+{
+    auto expected = static_cast<int>(longDelayIdle);
+    return mLongDelayState.compare_exchange_strong(expected, longDelayInUse) || expected == longDelayInUse;
+}
+
+void BagsComboAudioProcessor::requestLongDelayStorage(int numSamples) noexcept
+{
+    auto requested = mRequestedLongDelaySamples.load(std::memory_order_relaxed);
+
+    while (numSamples > requested && ! mRequestedLongDelaySamples.compare_exchange_weak(requested, numSamples))
+    {
+    }
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -122,6 +380,14 @@ bool BagsComboAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts
    #if ! JucePlugin_IsSynth
     if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
         return false;
+
+    // The sidechain is optional, mono or stereo
+    auto sidechain = layouts.getChannelSet(true, 1);
+
+    if (! sidechain.isDisabled()
+     && sidechain != juce::AudioChannelSet::mono()
+     && sidechain != juce::AudioChannelSet::stereo())
+        return false;
    #endif
 
     return true;
@@ -131,25 +397,369 @@ bool BagsComboAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts
 
 void BagsComboAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
+    BAGS_RT_SAFETY_SCOPE(buffer.getNumSamples(), getSampleRate());
+    juce::AudioProcessLoadMeasurer::ScopedTimer loadTimer(mLoadMeasurer, buffer.getNumSamples());
+    juce::ScopedNoDenormals noDeNormals;
+
+    // Coming back from a cut bypass, the old tails must not resurface. Whatever the bypass
+    // didn't get round to clearing is finished a slice per block, and the input carries on
+    // passing straight through like it did while bypassed.
+    if (! continueClearingTails(tailClearSamplesPerBlock))
+    {
+        for (auto i = getMainBusNumInputChannels(); i < getMainBusNumOutputChannels(); ++i)
+            buffer.clear(i, 0, buffer.getNumSamples());
+
+        return;
+    }
+
+    mTailsCut = false;
+    mBypassTailFinished = false;
+    mBypassSilentSamples = 0;
+
+    processEffects(buffer, midiMessages);
+}
+
+void BagsComboAudioProcessor::processBlockBypassed(juce::AudioBuffer<float>& buffer, juce::MidiBuffer&)
+{
+    BAGS_RT_SAFETY_SCOPE(buffer.getNumSamples(), getSampleRate());
+    juce::AudioProcessLoadMeasurer::ScopedTimer loadTimer(mLoadMeasurer, buffer.getNumSamples());
     juce::ScopedNoDenormals noDeNormals;
-    auto totalNumInputChannels = getTotalNumInputChannels();
-    auto totalNumOutputChannels = getTotalNumOutputChannels();
+
+    auto numSamples = buffer.getNumSamples();
+    auto numChannels = juce::jmin(getMainBusNumInputChannels(), getMainBusNumOutputChannels(), mBypassDryBuffer.getNumChannels());
+
+    for (auto i = getMainBusNumInputChannels(); i < getMainBusNumOutputChannels(); ++i)
+        buffer.clear(i, 0, numSamples);
+
+    // The dry path never has any latency (eco mode only delays the wet reverb), so the
+    // input is already where it belongs and passing it through stays compensated.
+    // A cut drops the tails while the output is dry anyway, a slice per block, and
+    // processBlock finishes whatever is left.
+    if (bypassMode == BypassMode::cut)
+    {
+        if (! mTailsCut)
+        {
+            mTailsCut = true;
+            mTailClearPosition = 0;
+        }
+
+        continueClearingTails(tailClearSamplesPerBlock);
+        return;
+    }
+
+    if (mBypassTailFinished || mMaxBlockSize <= 0)
+        return;
+
+    // Ring out: the effects keep running on silence and their tails are added to the untouched input
+    for (auto chunkStart = 0; chunkStart < numSamples; chunkStart += mMaxBlockSize)
+    {
+        auto chunkSamples = juce::jmin(mMaxBlockSize, numSamples - chunkStart);
+        juce::AudioBuffer<float> chunk(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), chunkStart, chunkSamples);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            mBypassDryBuffer.copyFrom(channel, 0, chunk, channel, 0, chunkSamples);
+            chunk.clear(channel, 0, chunkSamples);
+        }
+
+        processEffects(chunk, mBypassMidi);
+
+        auto tailLevel = 0.0f;
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            tailLevel = juce::jmax(tailLevel, chunk.getMagnitude(channel, 0, chunkSamples));
+            chunk.addFrom(channel, 0, mBypassDryBuffer, channel, 0, chunkSamples);
+        }
+
+        mBypassSilentSamples = tailLevel < bypassSilenceLevel ? mBypassSilentSamples + chunkSamples : 0;
+    }
+
+    // Once the tails have been silent for longer than the longest echo takes to come
+    // round, there is nothing left to ring out and the bypass becomes a plain pass through
+    auto longestDelay = juce::jmax(delayTime, delayMode == DelayMode::stereo ? delayTimeRight : 0.0f);
+
+    if (! freeze && mBypassSilentSamples > static_cast<int>((longestDelay / 1000.0f + 0.5f) * mSampleRate))
+        mBypassTailFinished = true;
+}
+
+void BagsComboAudioProcessor::processEffects(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    auto totalNumInputChannels = getMainBusNumInputChannels();
+    auto totalNumOutputChannels = getMainBusNumOutputChannels();
 
 
     // clear channels
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear(i, 0, buffer.getNumSamples());
 
+    if (auto* playHead = getPlayHead())
+        if (auto position = playHead->getPosition())
+            if (auto bpm = position->getBpm())
+                mHostBeatLength = 60.0 / *bpm;
+
+    // Only the main bus gets processed, the sidechain just drives the ducking
+    auto mainBuffer = getBusBuffer(buffer, false, 0);
+    auto sidechainBus = getBus(true, 1);
+    auto useSidechain = duckingEnabled && sidechainBus != nullptr && sidechainBus->isEnabled()
+                     && getChannelCountOfBus(true, 1) > 0;
+    auto sidechainBuffer = getBusBuffer(buffer, true, useSidechain ? 1 : 0);
+
+    if (useSidechain)
+    {
+        if (! mDuckerActive)
+            mDucker.reset();
+
+        mDucker.setParameters(duckThreshold, duckDepth, duckAttack, duckRelease);
+    }
+
+    mDuckerActive = useSidechain;
+
+    // Long delay mode off lets the timer free the long lines, on takes them back unless
+    // it's in the middle of that, in which case the long delay sits this block out
+    if (longDelayMode)
+    {
+        mLongDelayLinesHeld = acquireLongDelayLines();
+    }
+    else
+    {
+        auto expected = static_cast<int>(longDelayInUse);
+        mLongDelayState.compare_exchange_strong(expected, longDelayIdle);
+        mLongDelayLinesHeld = false;
+    }
+
+    // Split the block at every MIDI control event, so each change lands on its exact sample.
+    // Blocks larger than prepareToPlay promised are also cut down to size here.
+    auto numSamples = mainBuffer.getNumSamples();
+    auto numEvents = mMidiControl.collectEvents(midiMessages, numSamples);
+    auto chunkSize = mMaxBlockSize > 0 ? mMaxBlockSize : numSamples;
+    auto nextEvent = 0;
+
+    for (auto chunkStart = 0; chunkStart < numSamples; chunkStart += chunkSize)
+    {
+        auto chunkEnd = juce::jmin(numSamples, chunkStart + chunkSize);
+        auto duckGains = useSidechain ? mDucker.process(sidechainBuffer, chunkStart, chunkEnd - chunkStart) : nullptr;
+        mModulationMatrix.process(mainBuffer, useSidechain ? &sidechainBuffer : nullptr, chunkStart, chunkEnd - chunkStart);
+        auto segmentStart = chunkStart;
+
+        for (; nextEvent < numEvents && mMidiControl.getEvent(nextEvent).samplePosition < chunkEnd; ++nextEvent)
+        {
+            auto& event = mMidiControl.getEvent(nextEvent);
+
+            if (event.samplePosition > segmentStart)
+            {
+                processSegment(mainBuffer, segmentStart, event.samplePosition - segmentStart,
+                               duckGains != nullptr ? duckGains + (segmentStart - chunkStart) : nullptr,
+                               segmentStart - chunkStart);
+                segmentStart = event.samplePosition;
+            }
+
+            handleMidiEvent(event);
+        }
+
+        processSegment(mainBuffer, segmentStart, chunkEnd - segmentStart,
+                       duckGains != nullptr ? duckGains + (segmentStart - chunkStart) : nullptr,
+                       segmentStart - chunkStart);
+    }
+}
+
+void BagsComboAudioProcessor::processSegment(juce::AudioBuffer<float>& buffer, int startSample, int numSamples, const float* duckGains, int modulationOffset)
+{
+    if (numSamples <= 0)
+        return;
+
+    // Refers to the host's channel data, nothing is copied or allocated
+    juce::AudioBuffer<float> segment(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), startSample, numSamples);
+
+    // Per sample values for whatever the modulation matrix drives, nullptr otherwise
+    using Destination = ModulationMatrix::Destination;
+    auto modulated = [this, modulationOffset, numSamples] (Destination destination, float base, float maxValue)
+    {
+        return mModulationMatrix.getValues(destination, base, maxValue, modulationOffset, numSamples);
+    };
+
+    auto delayTimes = modulated(Destination::delayTime, delayTime, longDelayMode ? maxLongDelayTime : maxDelayTime);
+    auto delayLevels = modulated(Destination::delayLevel, delayLevel, 1.0f);
+
     // Apply our delay effect to the new output..
-    applyDelay(buffer, mDelayBuffer, delayLevel, delayTime);
+    if (freeze)
+        applyFrozenDelay(segment, delayLevel, delayTime, delayTimeRight, duckGains, delayLevels);
+    else if (longDelayMode)
+    {
+        if (mLongDelayLinesHeld)
+            applyLongDelay(segment, delayLevel, delayTime, duckGains, delayTimes, delayLevels);
+    }
+    else if (delayMode == DelayMode::stereo && segment.getNumChannels() >= 2)
+        applyStereoDelay(segment, delayLevel, delayTime, delayTimeRight, duckGains, delayTimes, delayLevels);
+    else if (tapeMode || delayDiffusion > 0.0f)
+        applyChunkedDelay(segment, delayLevel, delayTime, duckGains, delayTimes, delayLevels);
+    else
+        applyDelay(segment, mDelayBuffer, delayLevel, delayTime, duckGains, delayTimes, delayLevels);
+
+    // Add early reflections in front of the reverb tail
+    applyEarlyReflections(segment, earlyLevel, preDelay, duckGains);
 
     // Apply reverb effect 
-    applyReverb(buffer, roomSize, width, damp, wetLevel, dryLevel);
+    auto isModulated = [this] (Destination destination) { return mModulationMatrix.isModulated(destination); };
+
+    if (! isModulated(Destination::roomSize) && ! isModulated(Destination::width) && ! isModulated(Destination::damp)
+     && ! isModulated(Destination::wetLevel) && ! isModulated(Destination::dryLevel))
+    {
+        applyReverb(segment, roomSize, width, damp, wetLevel, dryLevel, duckGains);
+    }
+    else
+    {
+        // The reverbs take their parameters per call and smooth them internally,
+        // so they get a fresh set at every control point, wherever the block was cut
+        for (int start = 0, length = 0; start < numSamples; start += length)
+        {
+            auto offset = modulationOffset + start;
+            length = juce::jmin(mModulationMatrix.getSamplesToNextControlPoint(offset), numSamples - start);
+
+            auto valueAt = [this, offset] (Destination destination, float base)
+            {
+                return mModulationMatrix.getPeriodValue(destination, base, 1.0f, offset);
+            };
+
+            juce::AudioBuffer<float> period(segment.getArrayOfWritePointers(), segment.getNumChannels(), start, length);
+            applyReverb(period, valueAt(Destination::roomSize, roomSize), valueAt(Destination::width, width),
+                        valueAt(Destination::damp, damp), valueAt(Destination::wetLevel, wetLevel),
+                        valueAt(Destination::dryLevel, dryLevel), duckGains != nullptr ? duckGains + start : nullptr);
+        }
+    }
 
     // Apply our gain change to the outgoing data..
-    applyGain(buffer, mDelayBuffer, gainLevel);
+    applyGain(segment, mDelayBuffer, gainLevel);
+}
+
+void BagsComboAudioProcessor::handleMidiEvent(const MidiControl::Event& event)
+{
+    switch (event.type)
+    {
+        case MidiControl::Event::Type::controller:
+            if (juce::isPositiveAndBelow(event.parameter, static_cast<int>(Parameter::numParameters)))
+                setParameterNormalised(static_cast<Parameter>(event.parameter), event.value);
+            break;
 
-    
+        case MidiControl::Event::Type::delayDivision:
+            mDelayDivision = event.value;
+            updateSyncedDelayTime();
+            break;
+
+        case MidiControl::Event::Type::tap:
+            // a tap without a division yet means one echo per beat
+            if (event.value > 0.0f)
+            {
+                if (mDelayDivision <= 0.0f)
+                    mDelayDivision = 1.0f;
+
+                updateSyncedDelayTime();
+            }
+            break;
+    }
+}
+
+void BagsComboAudioProcessor::updateSyncedDelayTime()
+{
+    // Tapped tempo wins over the host tempo
+    auto beatLength = mMidiControl.getTappedBeatLength() > 0.0 ? mMidiControl.getTappedBeatLength()
+                                                              : mHostBeatLength;
+    auto maxTime = longDelayMode ? maxLongDelayTime : maxDelayTime;
+
+    delayTime = juce::jmin(maxTime, static_cast<float>(beatLength * mDelayDivision * 1000.0));
+    delayTimeRight = delayTime;
+}
+
+void BagsComboAudioProcessor::setParameterNormalised(Parameter parameter, float value) noexcept
+{
+    value = juce::jlimit(0.0f, 1.0f, value);
+    auto maxTime = longDelayMode ? maxLongDelayTime : maxDelayTime;
+
+    switch (parameter)
+    {
+        case Parameter::delayLevel:     delayLevel = value; break;
+        case Parameter::delayTime:      delayTime = value * maxTime; break;
+        case Parameter::delayTimeRight: delayTimeRight = value * maxTime; break;
+        case Parameter::crossFeedback:  crossFeedback = value; break;
+        case Parameter::delayWidth:     delayWidth = value; break;
+        case Parameter::tapeLowCut:     tapeLowCut = 20.0f * std::pow(25.0f, value); break;      // 20..500 Hz
+        case Parameter::tapeHighCut:    tapeHighCut = 1000.0f * std::pow(20.0f, value); break;   // 1k..20k Hz
+        case Parameter::tapeDrive:      tapeDrive = value; break;
+        case Parameter::tapeWow:        tapeWow = value; break;
+        case Parameter::tapeFlutter:    tapeFlutter = value; break;
+        case Parameter::earlyLevel:     earlyLevel = value; break;
+        case Parameter::preDelay:       preDelay = value * EarlyReflections::maxPreDelay; break;
+        case Parameter::roomSize:       roomSize = value; break;
+        case Parameter::width:          width = value; break;
+        case Parameter::damp:           damp = value; break;
+        case Parameter::wetLevel:       wetLevel = value; break;
+        case Parameter::dryLevel:       dryLevel = value; break;
+        case Parameter::gainLevel:      gainLevel = value; break;
+        case Parameter::duckThreshold:  duckThreshold = juce::jmap(value, -60.0f, 0.0f); break;
+        case Parameter::duckDepth:      duckDepth = value; break;
+        case Parameter::duckAttack:     duckAttack = juce::jmap(value, 1.0f, 100.0f); break;
+        case Parameter::duckRelease:    duckRelease = juce::jmap(value, 10.0f, 1000.0f); break;
+        case Parameter::delayDiffusion: delayDiffusion = value; break;
+        case Parameter::diffusionSize:  diffusionSize = value; break;
+
+        // Long delay storage is committed by the timer, reads past it are silent until then
+        case Parameter::longDelayMode:
+            longDelayMode = value >= 0.5f;
+            delayTime = juce::jmin(delayTime, longDelayMode ? maxLongDelayTime : maxDelayTime);
+            delayTimeRight = juce::jmin(delayTimeRight, longDelayMode ? maxLongDelayTime : maxDelayTime);
+            break;
+
+        case Parameter::delayMode:       delayMode = value >= 0.5f ? DelayMode::stereo : DelayMode::classic; break;
+        case Parameter::tapeMode:        tapeMode = value >= 0.5f; break;
+        case Parameter::freeze:          freeze = value >= 0.5f; break;
+        case Parameter::reverbAlgorithm: reverbAlgorithm = value >= 0.5f ? ReverbAlgorithm::fdn : ReverbAlgorithm::freeverb; break;
+        case Parameter::reverbQuality:   reverbQuality = static_cast<ReverbQuality>(juce::jmin(2, static_cast<int>(value * 3.0f))); break;
+        case Parameter::duckingEnabled:  duckingEnabled = value >= 0.5f; break;
+        case Parameter::bypassMode:      bypassMode = value >= 0.5f ? BypassMode::cut : BypassMode::ringOut; break;
+        case Parameter::numParameters:   break;
+    }
+}
+
+juce::String BagsComboAudioProcessor::getParameterName(Parameter parameter)
+{
+    switch (parameter)
+    {
+        case Parameter::delayLevel:      return "delay level";
+        case Parameter::delayTime:       return "delay time";
+        case Parameter::delayTimeRight:  return "delay time right";
+        case Parameter::crossFeedback:   return "cross feedback";
+        case Parameter::delayWidth:      return "delay width";
+        case Parameter::tapeLowCut:      return "tape low cut";
+        case Parameter::tapeHighCut:     return "tape high cut";
+        case Parameter::tapeDrive:       return "tape drive";
+        case Parameter::tapeWow:         return "tape wow";
+        case Parameter::tapeFlutter:     return "tape flutter";
+        case Parameter::earlyLevel:      return "early level";
+        case Parameter::preDelay:        return "pre delay";
+        case Parameter::roomSize:        return "size";
+        case Parameter::width:           return "width";
+        case Parameter::damp:            return "damp";
+        case Parameter::wetLevel:        return "wet";
+        case Parameter::dryLevel:        return "dry";
+        case Parameter::gainLevel:       return "gain";
+        case Parameter::duckThreshold:   return "duck threshold";
+        case Parameter::duckDepth:       return "duck depth";
+        case Parameter::duckAttack:      return "duck attack";
+        case Parameter::duckRelease:     return "duck release";
+        case Parameter::delayDiffusion:  return "diffusion";
+        case Parameter::diffusionSize:   return "diffusion size";
+        case Parameter::longDelayMode:   return "long delay";
+        case Parameter::delayMode:       return "stereo delay";
+        case Parameter::tapeMode:        return "tape";
+        case Parameter::freeze:          return "freeze";
+        case Parameter::reverbAlgorithm: return "fdn reverb";
+        case Parameter::reverbQuality:   return "reverb quality";
+        case Parameter::duckingEnabled:  return "ducking";
+        case Parameter::bypassMode:      return "cut on bypass";
+        case Parameter::numParameters:   break;
+    }
+
+    return {};
 }
 
 void BagsComboAudioProcessor::applyGain(juce::AudioBuffer<float>& buffer, juce::AudioBuffer<float>& delayBuffer, float gain)
@@ -160,7 +770,8 @@ void BagsComboAudioProcessor::applyGain(juce::AudioBuffer<float>& buffer, juce::
         buffer.applyGain(channel, 0, buffer.getNumSamples(), gain);
 }
 
-void BagsComboAudioProcessor::applyDelay(juce::AudioBuffer<float>& buffer, juce::AudioBuffer<float>& delayBuffer, float delayLevel, float delayTime)
+void BagsComboAudioProcessor::applyDelay(juce::AudioBuffer<float>& buffer, juce::AudioBuffer<float>& delayBuffer, float delayLevel, float delayTime, const float* duckGains,
+                                         const float* delayTimes, const float* delayLevels)
 {
     auto numSamples = buffer.getNumSamples();
     auto sampleRate = getSampleRate(); 
@@ -184,8 +795,12 @@ void BagsComboAudioProcessor::applyDelay(juce::AudioBuffer<float>& buffer, juce:
 
 
             auto in = channelData[sample];                               // get original sample
-            channelData[sample] += delayData[delayReadPos] * delayLevel; // add effects to delay sample and add to main buffer
-            delayData[delayWritePos] = (channelData[sample]);            // add main buffer sample to delay buffer
+            auto delayed = delayTimes != nullptr ? readInterpolated(delayData, delayBuffer.getNumSamples(), 1, delayWritePos,
+                                                                    delayTimes[sample] / 1000 * mSampleRate)
+                                                 : delayData[delayReadPos];
+            delayed *= delayLevels != nullptr ? delayLevels[sample] : delayLevel; // add effects to delay sample
+            delayData[delayWritePos] = in + delayed;                     // add main buffer sample to delay buffer, never ducked
+            channelData[sample] = in + (duckGains != nullptr ? delayed * duckGains[sample] : delayed); // and add to main buffer
 
             if (++delayWritePos >= delayBuffer.getNumSamples())
                 delayWritePos = 0;
@@ -195,8 +810,347 @@ void BagsComboAudioProcessor::applyDelay(juce::AudioBuffer<float>& buffer, juce:
     mDelayPosition = delayWritePos;
 }
 
+void BagsComboAudioProcessor::applyChunkedDelay(juce::AudioBuffer<float>& buffer, float delayLevel, float delayTime, const float* duckGains,
+                                                const float* delayTimes, const float* delayLevels)
+{
+    auto numSamples = buffer.getNumSamples();
+    auto length = mDelayBuffer.getNumSamples();
+    auto numChannels = juce::jmin(buffer.getNumChannels(), (int) TapeFeedback::maxChannels);
+    auto* playback = mTapeBuffer.getWritePointer(0);
+    auto* record = mTapeBuffer.getWritePointer(1);
+
+    auto diffuse = delayDiffusion > 0.0f;
+
+    if (tapeMode)
+        mTapeFeedback.setParameters(tapeLowCut, tapeHighCut, tapeDrive, tapeWow, tapeFlutter);
+
+    // Whatever the diffusers still hold from the last time they ran is stale
+    if (diffuse && ! mDiffuserActive)
+        mDiffuser.reset();
+
+    mDiffuserActive = diffuse;
+
+    if (diffuse)
+        mDiffuser.setParameters(delayDiffusion, diffusionSize, diffusionStages);
+
+    for (auto start = 0; start < numSamples;)
+    {
+        // A chunk no longer than the delay never reads back what it writes itself,
+        // so filtering, diffusion and saturation can run over the whole chunk at once
+        auto shortestDelay = delayTimes != nullptr ? juce::FloatVectorOperations::findMinimum(delayTimes + start, numSamples - start)
+                                                   : delayTime;
+        auto numChunkSamples = juce::jlimit(1, juce::jmin(numSamples - start, mTapeBuffer.getNumSamples()),
+                                            static_cast<int>(shortestDelay / 1000 * mSampleRate) - 1);
+        auto* offsets = tapeMode ? mTapeFeedback.advanceModulation(numChunkSamples) : nullptr;
+
+        for (auto channel = 0; channel < numChannels; ++channel)
+        {
+            auto channelData = buffer.getWritePointer(channel, start);
+            auto delayData = mDelayBuffer.getWritePointer(juce::jmin(channel, mDelayBuffer.getNumChannels() - 1));
+
+            // Playback head, wow and flutter only ever lengthen the delay
+            for (auto sample = 0; sample < numChunkSamples; ++sample)
+            {
+                auto time = delayTimes != nullptr ? delayTimes[start + sample] : delayTime;
+                auto position = mDelayPosition + sample;
+
+                if (position >= length)
+                    position -= length;
+
+                playback[sample] = readInterpolated(delayData, length, 1, position,
+                                                    time / 1000 * mSampleRate + (offsets != nullptr ? offsets[sample] : 0.0f));
+            }
+
+            if (tapeMode)
+                mTapeFeedback.filter(channel, playback, numChunkSamples);
+
+            if (diffuse)
+                mDiffuser.process(channel, playback, numChunkSamples);
+
+            if (delayLevels != nullptr)
+                juce::FloatVectorOperations::multiply(playback, delayLevels + start, numChunkSamples);
+            else
+                juce::FloatVectorOperations::multiply(playback, delayLevel, numChunkSamples);
+
+            // Record head: input plus feedback, saturated on the way onto the tape
+            juce::FloatVectorOperations::add(record, channelData, playback, numChunkSamples);
+
+            if (tapeMode)
+                mTapeFeedback.saturate(record, numChunkSamples);
+
+            auto firstRun = juce::jmin(numChunkSamples, length - mDelayPosition);
+            juce::FloatVectorOperations::copy(delayData + mDelayPosition, record, firstRun);
+            juce::FloatVectorOperations::copy(delayData, record + firstRun, numChunkSamples - firstRun);
+
+            // only what we hear is ducked, the feedback keeps its level
+            if (duckGains != nullptr)
+                juce::FloatVectorOperations::multiply(playback, duckGains + start, numChunkSamples);
+
+            juce::FloatVectorOperations::add(channelData, playback, numChunkSamples);
+        }
+
+        mDelayPosition = (mDelayPosition + numChunkSamples) % length;
+        start += numChunkSamples;
+    }
+}
+
+void BagsComboAudioProcessor::applyFrozenDelay(juce::AudioBuffer<float>& buffer, float delayLevel, float delayTime, float delayTimeRight, const float* duckGains,
+                                               const float* delayLevels)
+{
+    // Frozen, the delay only recirculates what it holds: no input, no feedback level,
+    // no filtering. The loop stays one delay time long. What we hear is still scaled
+    // by delayLevel, like the echoes were before the freeze.
+    auto numSamples = buffer.getNumSamples();
+
+    auto outputGain = [=] (int sample)
+    {
+        auto gain = delayLevels != nullptr ? delayLevels[sample] : delayLevel;
+        return duckGains != nullptr ? gain * duckGains[sample] : gain;
+    };
+
+    if (longDelayMode)
+    {
+        if (! mLongDelayLinesHeld)
+            return;
+
+        int delaySamples = static_cast<int>(juce::jmin(delayTime, maxLongDelayTime) / 1000 * mSampleRate);
+
+        for (auto channel = 0; channel < juce::jmin(buffer.getNumChannels(), 2); ++channel)
+        {
+            auto channelData = buffer.getWritePointer(channel);
+            auto& line = mLongDelayLines[channel];
+
+            for (auto sample = 0; sample < numSamples; ++sample)
+            {
+                auto held = line.read(delaySamples);
+                line.write(held);
+                channelData[sample] += held * outputGain(sample);
+            }
+        }
+
+        return;
+    }
+
+    if (delayMode == DelayMode::stereo && buffer.getNumChannels() >= 2)
+    {
+        auto left = buffer.getWritePointer(0);
+        auto right = buffer.getWritePointer(1);
+        auto delayData = mStereoDelayBuffer.get();
+        auto length = mStereoDelayLength;
+        auto writePos = mStereoDelayPosition;
+        auto readPosLeft = (writePos + length - juce::jlimit(1, length - 1, static_cast<int>(delayTime / 1000 * mSampleRate))) % length;
+        auto readPosRight = (writePos + length - juce::jlimit(1, length - 1, static_cast<int>(delayTimeRight / 1000 * mSampleRate))) % length;
+
+        // Each channel loops on itself, the cross feed would smear the held pattern
+        for (auto sample = 0; sample < numSamples; ++sample)
+        {
+            auto heldA = delayData[2 * writePos] = delayData[2 * readPosLeft];
+            auto heldB = delayData[2 * writePos + 1] = delayData[2 * readPosRight + 1];
+            auto gain = outputGain(sample);
+            heldA *= gain;
+            heldB *= gain;
+
+            auto wetMid = delayMidSide ? heldA : 0.5f * (heldA + heldB);
+            auto wetSide = (delayMidSide ? heldB : 0.5f * (heldA - heldB)) * delayWidth;
+            left[sample] += wetMid + wetSide;
+            right[sample] += wetMid - wetSide;
+
+            if (++writePos >= length)     writePos = 0;
+            if (++readPosLeft >= length)  readPosLeft = 0;
+            if (++readPosRight >= length) readPosRight = 0;
+        }
+
+        mStereoDelayPosition = writePos;
+        return;
+    }
+
+    // Classic and tape share mDelayBuffer. Copying the loop forward one delay time in
+    // runs no longer than the delay never reads what it has just written.
+    auto length = mDelayBuffer.getNumSamples();
+    auto delaySamples = juce::jlimit(1, length - 1, static_cast<int>(delayTime / 1000 * mSampleRate));
+
+    for (auto start = 0; start < numSamples;)
+    {
+        auto numChunkSamples = juce::jmin(numSamples - start, delaySamples);
+
+        for (auto channel = 0; channel < buffer.getNumChannels(); ++channel)
+        {
+            auto channelData = buffer.getWritePointer(channel, start);
+            auto delayData = mDelayBuffer.getWritePointer(juce::jmin(channel, mDelayBuffer.getNumChannels() - 1));
+            auto readPos = (mDelayPosition + length - delaySamples) % length;
+            auto writePos = mDelayPosition;
+
+            for (auto done = 0; done < numChunkSamples;)
+            {
+                auto run = juce::jmin(numChunkSamples - done, length - readPos, length - writePos);
+                juce::FloatVectorOperations::copy(delayData + writePos, delayData + readPos, run);
+
+                if (duckGains == nullptr && delayLevels == nullptr)
+                {
+                    juce::FloatVectorOperations::addWithMultiply(channelData + done, delayData + writePos, delayLevel, run);
+                }
+                else
+                {
+                    for (auto i = 0; i < run; ++i)
+                        channelData[done + i] += delayData[writePos + i] * outputGain(start + done + i);
+                }
+
+                done += run;
+                readPos = (readPos + run) % length;
+                writePos = (writePos + run) % length;
+            }
+        }
+
+        mDelayPosition = (mDelayPosition + numChunkSamples) % length;
+        start += numChunkSamples;
+    }
+}
+
+void BagsComboAudioProcessor::applyLongDelay(juce::AudioBuffer<float>& buffer, float delayLevel, float delayTime, const float* duckGains,
+                                             const float* delayTimes, const float* delayLevels)
+{
+    auto numSamples = buffer.getNumSamples();
+
+    // Convert delay time from milliseconds to samples
+    int delaySamples = static_cast<int>(juce::jmin(delayTime, maxLongDelayTime) / 1000 * mSampleRate);
+
+    // MIDI, tap tempo and modulation change the time on this thread, the timer commits the storage.
+    // Until it has, reads that far back are silent.
+    auto longestDelay = delayTimes != nullptr ? juce::FloatVectorOperations::findMaximum(delayTimes, numSamples) : delayTime;
+    requestLongDelayStorage(static_cast<int>(juce::jmin(longestDelay, maxLongDelayTime) / 1000 * mSampleRate) + 2);
+
+    for (auto channel = 0; channel < juce::jmin(getTotalNumOutputChannels(), 2); ++channel)
+    {
+        auto channelData = buffer.getWritePointer(channel);
+        auto& line = mLongDelayLines[channel];
+
+        for (auto sample = 0; sample < numSamples; ++sample)
+        {
+            auto delayed = delayTimes != nullptr ? line.readInterpolated(delayTimes[sample] / 1000 * mSampleRate)
+                                                 : line.read(delaySamples);
+            delayed *= delayLevels != nullptr ? delayLevels[sample] : delayLevel;
+            line.write(channelData[sample] + delayed);                   // feed main buffer back into the line
+            channelData[sample] += duckGains != nullptr ? delayed * duckGains[sample] : delayed; // add delayed sample to main buffer
+        }
+    }
+}
+
+void BagsComboAudioProcessor::applyStereoDelay(juce::AudioBuffer<float>& buffer, float delayLevel, float delayTimeLeft, float delayTimeRight, const float* duckGains,
+                                               const float* delayTimes, const float* delayLevels)
+{
+    auto numSamples = buffer.getNumSamples();
+    auto left = buffer.getWritePointer(0);
+    auto right = buffer.getWritePointer(1);
+    auto delayData = mStereoDelayBuffer.get();
+    auto length = mStereoDelayLength;
+
+    // Convert delay times from milliseconds to samples
+    auto delaySamplesLeft = juce::jlimit(0, length - 1, static_cast<int>(delayTimeLeft / 1000 * mSampleRate));
+    auto delaySamplesRight = juce::jlimit(0, length - 1, static_cast<int>(delayTimeRight / 1000 * mSampleRate));
+
+    // Feedback matrix: delayLevel on the diagonal, shifted across to the other channel by crossFeedback
+    auto straight = delayLevel * (1.0f - crossFeedback);
+    auto cross = delayLevel * crossFeedback;
+
+    auto writePos = mStereoDelayPosition;
+    auto readPosLeft = (writePos + length - delaySamplesLeft) % length;
+    auto readPosRight = (writePos + length - delaySamplesRight) % length;
+
+    // Both channels in one pass over the interleaved frames
+    for (auto sample = 0; sample < numSamples; ++sample)
+    {
+        auto inA = left[sample];
+        auto inB = right[sample];
+
+        if (delayMidSide)
+        {
+            inA = 0.5f * (left[sample] + right[sample]);
+            inB = 0.5f * (left[sample] - right[sample]);
+        }
+
+        auto delayedA = delayData[2 * readPosLeft];
+        auto delayedB = delayData[2 * readPosRight + 1];
+
+        // A modulated time moves both taps together, keeping the offset between them
+        if (delayTimes != nullptr)
+        {
+            auto offset = (delayTimes[sample] - delayTimeLeft) / 1000 * mSampleRate;
+            delayedA = readInterpolated(delayData, length, 2, writePos, (float) delaySamplesLeft + offset);
+            delayedB = readInterpolated(delayData + 1, length, 2, writePos, (float) delaySamplesRight + offset);
+        }
+
+        if (delayLevels != nullptr)
+        {
+            straight = delayLevels[sample] * (1.0f - crossFeedback);
+            cross = delayLevels[sample] * crossFeedback;
+        }
+
+        auto wetA = straight * delayedA + cross * delayedB;
+        auto wetB = cross * delayedA + straight * delayedB;
+
+        // The more cross feedback, the more the left line takes the mono sum and the right one
+        // nothing, so at 1 even a centred source starts on one side and bounces between them
+        auto feedA = inA;
+        auto feedB = inB;
+
+        if (! delayMidSide)
+        {
+            feedA = inA + crossFeedback * (0.5f * (inA + inB) - inA);
+            feedB = (1.0f - crossFeedback) * inB;
+        }
+
+        delayData[2 * writePos] = feedA + wetA;     // feed output back into the delay buffer
+        delayData[2 * writePos + 1] = feedB + wetB;
+
+        // only what we hear is ducked, the feedback keeps its level
+        if (duckGains != nullptr)
+        {
+            wetA *= duckGains[sample];
+            wetB *= duckGains[sample];
+        }
+
+        if (delayMidSide)
+        {
+            auto mid = inA + wetA;
+            auto side = inB + wetB * delayWidth;
+            left[sample] = mid + side;
+            right[sample] = mid - side;
+        }
+        else
+        {
+            auto wetMid = 0.5f * (wetA + wetB);
+            auto wetSide = 0.5f * (wetA - wetB) * delayWidth;
+            left[sample] = inA + wetMid + wetSide;
+            right[sample] = inB + wetMid - wetSide;
+        }
+
+        if (++writePos >= length)     writePos = 0;
+        if (++readPosLeft >= length)  readPosLeft = 0;
+        if (++readPosRight >= length) readPosRight = 0;
+    }
+
+    mStereoDelayPosition = writePos;
+}
+
+void BagsComboAudioProcessor::applyEarlyReflections(juce::AudioBuffer<float>& buffer, float earlyLevel, float preDelay, const float* duckGains)
+{
+    if (earlyLevel <= 0.0f)
+    {
+        mEarlyReflectionsActive = false;
+        return;
+    }
+
+    // don't replay whatever was left in the line the last time it was switched on
+    if (! mEarlyReflectionsActive)
+        earlyReflections.reset();
+
+    mEarlyReflectionsActive = true;
+
+    earlyReflections.setParameters(roomSize, width, preDelay, earlyTaps);
+    earlyReflections.process(buffer, earlyLevel, duckGains);
+}
 
-void BagsComboAudioProcessor::applyReverb(juce::AudioBuffer<float>& buffer, float roomSize, float width, float damp, float wetLevel, float dryLevel)
+void BagsComboAudioProcessor::applyReverb(juce::AudioBuffer<float>& buffer, float roomSize, float width, float damp, float wetLevel, float dryLevel, const float* duckGains)
 {
     // Set the reverb parameters
     juce::Reverb::Parameters reverbParameters;
@@ -205,17 +1159,138 @@ void BagsComboAudioProcessor::applyReverb(juce::AudioBuffer<float>& buffer, floa
     reverbParameters.width = width;
     reverbParameters.wetLevel = wetLevel;
     reverbParameters.dryLevel = dryLevel;
-    reverb.setParameters(reverbParameters);
+    reverbParameters.freezeMode = freeze ? 1.0f : 0.0f;
+
+    // Whichever reverb this switches to still holds its tail from the last time it ran
+    if (reverbQuality != mActiveReverbQuality || reverbAlgorithm != mActiveReverbAlgorithm)
+    {
+        resetSelectedReverb();
+        mActiveReverbQuality = reverbQuality;
+        mActiveReverbAlgorithm = reverbAlgorithm;
+    }
+
+    if (reverbQuality != ReverbQuality::full)
+    {
+        applyReducedRateReverb(buffer, reverbParameters, duckGains);
+        return;
+    }
+
+    fdnReverb.setModulationEnabled(reverbModulation);
+
+    if (duckGains != nullptr)
+    {
+        // Run the reverb wet only on a copy, so the ducking only touches the tail
+        auto wetParameters = reverbParameters;
+        wetParameters.dryLevel = 0.0f;
+        reverb.setParameters(wetParameters);
+        fdnReverb.setParameters(wetParameters);
+
+        auto numSamples = buffer.getNumSamples();
+        auto numChannels = juce::jmin(buffer.getNumChannels(), mReverbWetBuffer.getNumChannels());
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            mReverbWetBuffer.copyFrom(channel, 0, buffer, channel, 0, numSamples);
 
+        processReverb(reverb, fdnReverb, mReverbWetBuffer.getArrayOfWritePointers(), numChannels, numSamples);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            auto* wet = mReverbWetBuffer.getWritePointer(channel);
+            juce::FloatVectorOperations::multiply(wet, duckGains, numSamples);
+
+            buffer.applyGain(channel, 0, numSamples, reverbParameters.dryLevel * 2.0f); // same dry scaling as juce::Reverb
+            buffer.addFrom(channel, 0, wet, numSamples);
+        }
+
+        return;
+    }
+
+    reverb.setParameters(reverbParameters);
+    fdnReverb.setParameters(reverbParameters);
 
     // Apply reverb to the audio buffer
-    for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+    processReverb(reverb, fdnReverb, buffer.getArrayOfWritePointers(), buffer.getNumChannels(), buffer.getNumSamples());
+}
+
+void BagsComboAudioProcessor::resetSelectedReverb() noexcept
+{
+    auto fdn = reverbAlgorithm == ReverbAlgorithm::fdn;
+
+    if (reverbQuality == ReverbQuality::full)
     {
-        float* channelData = buffer.getWritePointer(channel);
-        reverb.processMono(channelData, buffer.getNumSamples());
+        if (fdn)
+            fdnReverb.reset();
+        else
+            reverb.reset();
+
+        return;
     }
 
+    // The resampler filters too, at the new stage count so the FIFO gets primed for it
+    auto numStages = reverbQuality == ReverbQuality::quarter ? 2 : 1;
+    mReducedRateProcessor.setNumStages(numStages);
+    mReducedRateProcessor.reset();
+
+    if (fdn)
+        mReducedRateFdnReverbs[numStages - 1].reset();
+    else
+        mReducedRateReverbs[numStages - 1].reset();
+}
+
+void BagsComboAudioProcessor::processReverb(juce::Reverb& freeverb, FdnReverb& fdn, float* const* channels, int numChannels, int numSamples)
+{
+    if (reverbAlgorithm == ReverbAlgorithm::fdn)
+    {
+        // The network is stereo by nature, mono buses get the summed outputs
+        if (numChannels >= 2)
+            fdn.processStereo(channels[0], channels[1], numSamples);
+        else if (numChannels == 1)
+            fdn.processMono(channels[0], numSamples);
+
+        return;
+    }
 
+    // One processMono per channel would run both channels through the same combs one
+    // after the other, so the left block's tail would leak into the right one
+    if (numChannels >= 2)
+        freeverb.processStereo(channels[0], channels[1], numSamples);
+    else if (numChannels == 1)
+        freeverb.processMono(channels[0], numSamples);
+}
+
+void BagsComboAudioProcessor::applyReducedRateReverb(juce::AudioBuffer<float>& buffer, const juce::Reverb::Parameters& reverbParameters, const float* duckGains)
+{
+    auto numStages = reverbQuality == ReverbQuality::quarter ? 2 : 1;
+    mReducedRateProcessor.setNumStages(numStages);
+
+    // Only the wet tail runs at the reduced rate, dry is mixed back in at full rate below
+    auto wetParameters = reverbParameters;
+    wetParameters.dryLevel = 0.0f;
+
+    auto& lowRateReverb = mReducedRateReverbs[numStages - 1];
+    auto& lowRateFdnReverb = mReducedRateFdnReverbs[numStages - 1];
+    lowRateReverb.setParameters(wetParameters);
+    lowRateFdnReverb.setParameters(wetParameters);
+    lowRateFdnReverb.setModulationEnabled(reverbModulation);
+
+    auto dryGain = reverbParameters.dryLevel * 2.0f; // same dry scaling as juce::Reverb
+    auto numChannels = juce::jmin(buffer.getNumChannels(), 2);
+    auto blockSize = mReducedRateProcessor.getMaxBlockSize();
+
+    for (int start = 0; start < buffer.getNumSamples(); start += blockSize)
+    {
+        auto numSamples = juce::jmin(blockSize, buffer.getNumSamples() - start);
+        int numReducedSamples = 0;
+        auto& reduced = mReducedRateProcessor.downsample(buffer, start, numSamples, numChannels, numReducedSamples);
+
+        processReverb(lowRateReverb, lowRateFdnReverb, reduced.getArrayOfWritePointers(), numChannels, numReducedSamples);
+
+        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+            buffer.applyGain(channel, start, numSamples, dryGain);
+
+        mReducedRateProcessor.upsampleAndAdd(buffer, start, numSamples, numChannels, numReducedSamples,
+                                             duckGains != nullptr ? duckGains + start : nullptr);
+    }
 }
 
 //==============================================================================
@@ -235,12 +1310,51 @@ void BagsComboAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
     // You should use this method to store your parameters in the memory block.
     // You could do that either as raw data, or use the XML or ValueTree classes
     // as intermediaries to make it easy to save and load complex data.
+    juce::XmlElement state("BagsComboState");
+
+    // The MIDI setup: learned CCs by parameter index, and the tap and division notes
+    auto* midi = state.createNewChildElement("MidiControl");
+    midi->setAttribute("tapNote", mMidiControl.tapNote);
+    midi->setAttribute("divisionBaseNote", mMidiControl.divisionBaseNote);
+
+    for (int controller = 0; controller < MidiControl::numControllers; ++controller)
+    {
+        auto parameter = mMidiControl.getMapping(controller);
+
+        if (parameter == MidiControl::unmapped)
+            continue;
+
+        auto* mapping = midi->createNewChildElement("Mapping");
+        mapping->setAttribute("controller", controller);
+        mapping->setAttribute("parameter", parameter);
+    }
+
+    copyXmlToBinary(state, destData);
 }
 
 void BagsComboAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
     // You should use this method to restore your parameters from this memory block,
     // whose contents will have been created by the getStateInformation() call.
+    auto state = getXmlFromBinary(data, sizeInBytes);
+
+    if (state == nullptr || ! state->hasTagName("BagsComboState"))
+        return;
+
+    if (auto* midi = state->getChildByName("MidiControl"))
+    {
+        mMidiControl.tapNote = midi->getIntAttribute("tapNote", mMidiControl.tapNote);
+        mMidiControl.divisionBaseNote = midi->getIntAttribute("divisionBaseNote", mMidiControl.divisionBaseNote);
+        mMidiControl.clearMappings();
+
+        for (auto* mapping : midi->getChildWithTagNameIterator("Mapping"))
+        {
+            auto parameter = mapping->getIntAttribute("parameter", MidiControl::unmapped);
+
+            if (juce::isPositiveAndBelow(parameter, static_cast<int>(Parameter::numParameters)))
+                mMidiControl.setMapping(mapping->getIntAttribute("controller", -1), parameter);
+        }
+    }
 }
 
 //==============================================================================
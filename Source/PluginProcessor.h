@@ -9,16 +9,69 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "LongDelayLine.h"
+#include "FdnReverb.h"
+#include "EarlyReflections.h"
+#include "HalfBandResampler.h"
+#include "MidiControl.h"
+#include "SidechainDucker.h"
+#include "ModulationMatrix.h"
+#include "TapeFeedback.h"
+#include "DelayDiffuser.h"
+#include "RealtimeSafetyChecker.h"
+#include "DspKernels.h"
 
 //==============================================================================
 /**
 */
-class BagsComboAudioProcessor : public juce::AudioProcessor
+class BagsComboAudioProcessor : public juce::AudioProcessor, private juce::Timer
 {
 
 public:
     float delayLevel { 0.8 };
     float delayTime { 10.0 };
+    bool longDelayMode { false };   // looper style delay times up to maxLongDelayTime, see setLongDelayMode
+
+    // Stereo mode runs both channels through one 2x2 feedback matrix
+    enum class DelayMode { classic, stereo };
+    DelayMode delayMode { DelayMode::classic };
+    float delayTimeRight { 10.0 };  // stereo mode, delayTime is then the left (or mid) time
+    float crossFeedback { 0.0 };    // 0 = independent channels, 1 = ping-pong from the mono sum
+    float delayWidth { 1.0 };       // stereo width of the echoes
+    bool delayMidSide { false };    // run the matrix on mid/side instead of left/right
+
+    // Tape character for the classic delay's feedback loop
+    bool tapeMode { false };
+    float tapeLowCut { 100.0 };     // Hz
+    float tapeHighCut { 5000.0 };   // Hz
+    float tapeDrive { 0.3 };        // 0..1
+    float tapeWow { 0.2 };          // 0..1
+    float tapeFlutter { 0.2 };      // 0..1
+
+    // Allpass diffusion in the classic delay's feedback loop, smears every repeat a bit more
+    float delayDiffusion { 0.0 };   // 0..1, 0 = off
+    float diffusionSize { 0.5 };    // 0..1
+    int diffusionStages { 6 };      // DelayDiffuser::minStages..maxStages
+
+    // Holds the delay and reverb tails indefinitely, new input only passes through dry.
+    // The FDN then only reads its lines round, freeverb has no such path (juce::Reverb
+    // keeps its combs private) and costs as much frozen as running.
+    bool freeze { false };
+
+    static constexpr float maxDelayTime { 1000.0f };
+    static constexpr float maxLongDelayTime { 60000.0f };
+
+    enum class ReverbAlgorithm { freeverb, fdn };
+    ReverbAlgorithm reverbAlgorithm { ReverbAlgorithm::freeverb };
+    bool reverbModulation { true };  // FDN only
+
+    // Rate the late reverb tail runs at. The dry signal and early reflections always run at full rate.
+    enum class ReverbQuality { full, half, quarter };
+    ReverbQuality reverbQuality { ReverbQuality::full };
+
+    float earlyLevel { 0.0 };   // early reflections in front of the reverb, 0 = off
+    float preDelay { 10.0 };    // milliseconds before the first reflection
+    int earlyTaps { 32 };
 
     float roomSize { 0.5 };
     float width { 0.5 };
@@ -28,6 +81,36 @@ public:
 
     float gainLevel{ 0.8 };
 
+    // Ducks the delay and reverb returns from the sidechain bus (when the host has it enabled)
+    bool duckingEnabled { false };
+    float duckThreshold { -30.0 };  // dB
+    float duckDepth { 0.5 };        // 0..1
+    float duckAttack { 10.0 };      // milliseconds
+    float duckRelease { 250.0 };    // milliseconds
+
+    // What a host bypass does with the delay and reverb tails: let them ring out over
+    // the dry signal, or cut them straight away
+    enum class BypassMode { ringOut, cut };
+    BypassMode bypassMode { BypassMode::ringOut };
+
+    // Everything that can be driven from outside the editor, e.g. by MIDI CCs.
+    // Saved CC mappings refer to these by index, so only ever add to the end.
+    enum class Parameter
+    {
+        delayLevel, delayTime, delayTimeRight, crossFeedback, delayWidth,
+        tapeLowCut, tapeHighCut, tapeDrive, tapeWow, tapeFlutter,
+        earlyLevel, preDelay,
+        roomSize, width, damp, wetLevel, dryLevel,
+        gainLevel,
+        duckThreshold, duckDepth, duckAttack, duckRelease,
+        delayDiffusion, diffusionSize,
+
+        // Switches, the upper half of the range turns them on (or picks the second choice)
+        longDelayMode, delayMode, tapeMode, freeze,
+        reverbAlgorithm, reverbQuality, duckingEnabled, bypassMode,
+        numParameters
+    };
+
 public:
     //==============================================================================
     BagsComboAudioProcessor();
@@ -37,11 +120,15 @@ public:
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
 
+    // Clears every tail and restarts the LFOs, so the same input always renders the same output
+    void reset() override;
+
    #ifndef JucePlugin_PreferredChannelConfigurations
     bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
    #endif
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlockBypassed (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
 
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
@@ -67,16 +154,128 @@ public:
     void setStateInformation (const void* data, int sizeInBytes) override;
 
 
-    void applyDelay(juce::AudioBuffer<float>& buffer, juce::AudioBuffer<float>& delayBuffer, float delayLevel, float delayTime);
+    // duckGains, when given, holds one sidechain gain per sample for the wet signal.
+    // delayTimes and delayLevels, when given, replace delayTime and delayLevel per sample.
+    void applyDelay(juce::AudioBuffer<float>& buffer, juce::AudioBuffer<float>& delayBuffer, float delayLevel, float delayTime, const float* duckGains = nullptr,
+                    const float* delayTimes = nullptr, const float* delayLevels = nullptr);
     void applyGain(juce::AudioBuffer<float>& buffer, juce::AudioBuffer<float>& delayBuffer, float gainLevel);
-    void applyReverb(juce::AudioBuffer<float>& buffer, float roomSize, float damping, float width, float wetLevel, float dryLevel);
+    void applyLongDelay(juce::AudioBuffer<float>& buffer, float delayLevel, float delayTime, const float* duckGains = nullptr,
+                        const float* delayTimes = nullptr, const float* delayLevels = nullptr);
+    void applyStereoDelay(juce::AudioBuffer<float>& buffer, float delayLevel, float delayTimeLeft, float delayTimeRight, const float* duckGains = nullptr,
+                          const float* delayTimes = nullptr, const float* delayLevels = nullptr);
+    // Classic delay with the tape character and/or diffusion in its feedback loop
+    void applyChunkedDelay(juce::AudioBuffer<float>& buffer, float delayLevel, float delayTime, const float* duckGains = nullptr,
+                           const float* delayTimes = nullptr, const float* delayLevels = nullptr);
+    void applyFrozenDelay(juce::AudioBuffer<float>& buffer, float delayLevel, float delayTime, float delayTimeRight, const float* duckGains = nullptr,
+                          const float* delayLevels = nullptr);
+    void applyEarlyReflections(juce::AudioBuffer<float>& buffer, float earlyLevel, float preDelay, const float* duckGains = nullptr);
+    void applyReverb(juce::AudioBuffer<float>& buffer, float roomSize, float damping, float width, float wetLevel, float dryLevel, const float* duckGains = nullptr);
+    void applyReducedRateReverb(juce::AudioBuffer<float>& buffer, const juce::Reverb::Parameters& reverbParameters, const float* duckGains);
+
+    // Commits long delay storage for the current delayTime, plus whatever the audio thread has
+    // asked for since (MIDI, tap tempo and modulation move the delay time too). With long delay
+    // mode off it frees the storage again, once the audio thread has let go of it. Allocates,
+    // so call from the message thread. A timer also calls it.
+    void updateLongDelayStorage();
+
+    // Switches long delay mode and commits its storage. Message thread only.
+    void setLongDelayMode(bool shouldUseLongDelay);
 
+    // Sets a parameter from a 0..1 value, mapped onto its range
+    void setParameterNormalised(Parameter parameter, float value) noexcept;
+    static juce::String getParameterName(Parameter parameter);
+
+    // CC learn, note to delay division and tap tempo settings
+    MidiControl& getMidiControl() noexcept { return mMidiControl; }
+
+    // LFOs, envelope followers and their routings
+    ModulationMatrix& getModulationMatrix() noexcept { return mModulationMatrix; }
+
+    // Instruction set variant picked in prepareToPlay, DspKernels::createBenchmarkReport compares them all
+    const DspKernels& getKernels() const noexcept { return *mKernels; }
+    bool forceScalarKernels { false };  // reference renders, takes effect at the next prepareToPlay
+
+    // Smoothed time spent in processBlock (or processBlockBypassed) as a percentage of
+    // the buffer period, bypassed blocks included. Safe to read from any thread.
+    double getCpuLoad() const noexcept { return mLoadMeasurer.getLoadAsPercentage(); }
 
 
 private:
+    void timerCallback() override;
+    void requestLongDelayStorage(int numSamples) noexcept;
+    bool acquireLongDelayLines() noexcept;
+
+    void processEffects(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages);
+
+    // Silences every delay and reverb tail in one go. Leaves tempo, MIDI learn and modulation alone.
+    void clearTails() noexcept;
+
+    // Same, spread over several calls: the first clears everything small, each call after that
+    // at most maxSamples of the two delay buffers. Returns true once every tail is silent.
+    bool continueClearingTails(int maxSamples) noexcept;
+    void clearSmallTails() noexcept;
+    void processSegment(juce::AudioBuffer<float>& buffer, int startSample, int numSamples, const float* duckGains, int modulationOffset);
+    void resetSelectedReverb() noexcept;
+    void processReverb(juce::Reverb& freeverb, FdnReverb& fdn, float* const* channels, int numChannels, int numSamples);
+    void handleMidiEvent(const MidiControl::Event& event);
+    void updateSyncedDelayTime();
+
+    MidiControl mMidiControl;
+    float mDelayDivision{ 0.0f };       // in beats, 0 until a division note arrives
+    double mHostBeatLength{ 0.5 };      // seconds, from the host tempo when it has one
+
+    int mMaxBlockSize{ 0 };
+    juce::AudioProcessLoadMeasurer mLoadMeasurer;
+
+    // Read-only host meter for getCpuLoad, updated from the timer
+    juce::AudioParameterFloat* mCpuLoadParameter{ nullptr };
+
+    // Host bypass
+    static constexpr float bypassSilenceLevel{ 1.0e-5f };   // -100 dB
+    static constexpr int tailClearSamplesPerBlock{ 1 << 16 };   // 256 KB of delay buffer per block
+    juce::AudioBuffer<float> mBypassDryBuffer;
+    juce::MidiBuffer mBypassMidi;       // always empty, MIDI control is ignored while bypassed
+    bool mTailsCut{ false };            // a cut bypass dropped the tails, they stay silent until processBlock runs
+    int mTailClearPosition{ -1 };       // next delay buffer sample continueClearingTails clears, -1 when done
+    bool mBypassTailFinished{ false };
+    int mBypassSilentSamples{ 0 };
+    const DspKernels* mKernels{ &DspKernels::getScalar() };
+    SidechainDucker mDucker;
+    bool mDuckerActive{ false };
+    ModulationMatrix mModulationMatrix;
+
     juce::AudioBuffer<float> mDelayBuffer;
     int mDelayPosition{ 0 };
+    DelayDiffuser mDiffuser;            // its allpass lines share one aligned arena
+    bool mDiffuserActive{ false };
+    juce::HeapBlock<float> mStereoDelayBuffer;   // interleaved left/right frames
+    int mStereoDelayLength{ 0 };
+    int mStereoDelayPosition{ 0 };
+    TapeFeedback mTapeFeedback;
+    juce::AudioBuffer<float> mTapeBuffer;       // playback and record head scratch
+    LongDelayLine mLongDelayLines[2];
+    std::atomic<int> mRequestedLongDelaySamples{ 0 };   // raised by the audio thread, committed by the timer
+
+    // Who owns the long lines' blocks. The timer only frees them from idle, and the audio
+    // thread only touches them once it has moved idle to inUse (see acquireLongDelayLines).
+    enum LongDelayState { longDelayIdle, longDelayInUse, longDelayShrinking };
+    std::atomic<int> mLongDelayState{ longDelayIdle };
+    bool mLongDelayLinesHeld{ false };  // audio thread, this block may use the long lines
+
+    // prepareToPlay and releaseResources may come from another thread than the timer's commits
+    juce::CriticalSection mLongDelayStorageLock;
+    EarlyReflections earlyReflections;
+    bool mEarlyReflectionsActive{ false };
     juce::Reverb reverb;
+    FdnReverb fdnReverb;
+
+    // Eco mode: one reverb of each kind per reduced rate, so switching never reallocates
+    ReducedRateProcessor mReducedRateProcessor;
+    juce::Reverb mReducedRateReverbs[ReducedRateProcessor::maxStages];
+    FdnReverb mReducedRateFdnReverbs[ReducedRateProcessor::maxStages];
+    ReverbQuality mActiveReverbQuality{ ReverbQuality::full };          // what applyReverb ran last
+    ReverbAlgorithm mActiveReverbAlgorithm{ ReverbAlgorithm::freeverb };
+    juce::AudioBuffer<float> mReverbWetBuffer;   // wet only copy while ducking
     int mSampleRate{ 44100 };
 
     //==============================================================================
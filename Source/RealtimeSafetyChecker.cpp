@@ -0,0 +1,278 @@
+/*
+  ==============================================================================
+
+    RealtimeSafetyChecker.cpp
+
+  ==============================================================================
+*/
+
+#include "RealtimeSafetyChecker.h"
+
+#if BAGS_RT_SAFETY_CHECKS
+
+#include <new>
+#include <cstdlib>
+
+#if JUCE_MSVC && JUCE_DEBUG
+ #include <crtdbg.h>
+#endif
+
+namespace
+{
+    thread_local bool onAudioThread = false;
+    thread_local bool violationsAllowed = false;
+    thread_local bool reporting = false;    // the assertion machinery may allocate itself
+    thread_local bool forwarding = false;   // inside our operator new/delete, already checked
+
+    std::atomic<int> numViolations{ 0 };
+    std::atomic<const char*> lastViolation{ nullptr };
+    std::atomic<bool> assertOnViolation{ true };
+
+    std::atomic<int> numCalls{ 0 };
+    std::atomic<juce::int64> totalTicks{ 0 };
+    std::atomic<juce::int64> worstTicks{ 0 };
+    std::atomic<double> worstLoad{ 0.0 };
+
+    template <typename Type>
+    void storeMaximum(std::atomic<Type>& maximum, Type value) noexcept
+    {
+        auto current = maximum.load(std::memory_order_relaxed);
+
+        while (value > current && ! maximum.compare_exchange_weak(current, value, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    void checkAllocation(const char* what) noexcept
+    {
+        if (onAudioThread && ! violationsAllowed && ! reporting && ! forwarding)
+            RealtimeSafetyChecker::reportViolation(what);
+    }
+
+    // Keeps the CRT hook quiet about the malloc/free behind an operator that has already reported
+    struct ScopedForwarding
+    {
+        ScopedForwarding() noexcept : wasForwarding(forwarding)   { forwarding = true; }
+        ~ScopedForwarding() noexcept                             { forwarding = wasForwarding; }
+
+        bool wasForwarding;
+    };
+
+    void* allocate(std::size_t size, const char* what) noexcept
+    {
+        checkAllocation(what);
+
+        const ScopedForwarding scope;
+        return std::malloc(size == 0 ? 1 : size);
+    }
+
+    void* allocateAligned(std::size_t size, std::align_val_t alignment, const char* what) noexcept
+    {
+        checkAllocation(what);
+
+        const ScopedForwarding scope;
+        auto align = juce::jmax(sizeof(void*), static_cast<std::size_t>(alignment));
+
+       #if JUCE_MSVC
+        return _aligned_malloc(size == 0 ? 1 : size, align);
+       #else
+        // aligned_alloc wants a whole number of alignments
+        return std::aligned_alloc(align, (juce::jmax((std::size_t) 1, size) + align - 1) / align * align);
+       #endif
+    }
+
+    void deallocate(void* p, const char* what) noexcept
+    {
+        if (p == nullptr)
+            return;
+
+        checkAllocation(what);
+
+        const ScopedForwarding scope;
+        std::free(p);
+    }
+
+    void deallocateAligned(void* p, const char* what) noexcept
+    {
+        if (p == nullptr)
+            return;
+
+        checkAllocation(what);
+
+        const ScopedForwarding scope;
+
+       #if JUCE_MSVC
+        _aligned_free(p);
+       #else
+        std::free(p);
+       #endif
+    }
+
+   #if JUCE_MSVC && JUCE_DEBUG
+    // Catches malloc/realloc/free too, but only in the debug CRT
+    int allocHook(int allocType, void*, size_t, int, long, const unsigned char*, int) noexcept
+    {
+        checkAllocation(allocType == _HOOK_FREE ? "free on the audio thread"
+                                                : "malloc on the audio thread");
+        return TRUE;
+    }
+
+    [[maybe_unused]] const auto previousAllocHook = _CrtSetAllocHook(allocHook);
+   #endif
+}
+
+//==============================================================================
+RealtimeSafetyChecker::ScopedAudioThread::ScopedAudioThread(int numSamples, double sampleRate) noexcept
+    : startTicks(juce::Time::getHighResolutionTicks()),
+      budgetSeconds(sampleRate > 0.0 ? numSamples / sampleRate : 0.0),
+      wasOnAudioThread(onAudioThread)
+{
+    onAudioThread = true;
+}
+
+RealtimeSafetyChecker::ScopedAudioThread::~ScopedAudioThread() noexcept
+{
+    auto ticks = juce::Time::getHighResolutionTicks() - startTicks;
+    onAudioThread = wasOnAudioThread;
+
+    numCalls.fetch_add(1, std::memory_order_relaxed);
+    totalTicks.fetch_add(ticks, std::memory_order_relaxed);
+    storeMaximum(worstTicks, ticks);
+
+    if (budgetSeconds > 0.0)
+        storeMaximum(worstLoad, juce::Time::highResolutionTicksToSeconds(ticks) / budgetSeconds);
+}
+
+RealtimeSafetyChecker::ScopedAllowViolations::ScopedAllowViolations() noexcept
+    : wasAllowed(violationsAllowed)
+{
+    violationsAllowed = true;
+}
+
+RealtimeSafetyChecker::ScopedAllowViolations::~ScopedAllowViolations() noexcept
+{
+    violationsAllowed = wasAllowed;
+}
+
+//==============================================================================
+bool RealtimeSafetyChecker::isOnAudioThread() noexcept
+{
+    return onAudioThread && ! violationsAllowed;
+}
+
+void RealtimeSafetyChecker::reportViolation(const char* what) noexcept
+{
+    if (reporting)
+        return;
+
+    reporting = true;
+
+    numViolations.fetch_add(1, std::memory_order_relaxed);
+    lastViolation.store(what, std::memory_order_relaxed);
+
+    // Look at the call stack, something in processBlock allocated or locked
+    if (assertOnViolation.load(std::memory_order_relaxed))
+        jassertfalse;
+
+    reporting = false;
+}
+
+RealtimeSafetyChecker::Statistics RealtimeSafetyChecker::getStatistics() noexcept
+{
+    Statistics statistics;
+    statistics.numViolations = numViolations.load();
+    statistics.lastViolation = lastViolation.load();
+    statistics.numCalls = numCalls.load();
+    statistics.worstSeconds = juce::Time::highResolutionTicksToSeconds(worstTicks.load());
+    statistics.averageSeconds = statistics.numCalls > 0 ? juce::Time::highResolutionTicksToSeconds(totalTicks.load()) / statistics.numCalls
+                                                        : 0.0;
+    statistics.worstLoad = worstLoad.load();
+    return statistics;
+}
+
+void RealtimeSafetyChecker::resetStatistics() noexcept
+{
+    numViolations = 0;
+    lastViolation = nullptr;
+    numCalls = 0;
+    totalTicks = 0;
+    worstTicks = 0;
+    worstLoad = 0.0;
+}
+
+void RealtimeSafetyChecker::setAssertOnViolation(bool shouldAssert) noexcept
+{
+    assertOnViolation = shouldAssert;
+}
+
+//==============================================================================
+// Replacements for the global allocation functions. They only exist in checked
+// builds and just forward to malloc/free once the thread has been checked.
+void* operator new(std::size_t size)
+{
+    if (auto* p = allocate(size, "operator new on the audio thread"))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    if (auto* p = allocate(size, "operator new[] on the audio thread"))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size, "operator new on the audio thread");
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size, "operator new[] on the audio thread");
+}
+
+void operator delete(void* p) noexcept                          { deallocate(p, "operator delete on the audio thread"); }
+void operator delete[](void* p) noexcept                        { deallocate(p, "operator delete[] on the audio thread"); }
+void operator delete(void* p, std::size_t) noexcept             { operator delete(p); }
+void operator delete[](void* p, std::size_t) noexcept           { operator delete[](p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept   { operator delete(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { operator delete[](p); }
+
+// Over-aligned types, e.g. anything holding an FdnReverb
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    if (auto* p = allocateAligned(size, alignment, "operator new on the audio thread"))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    if (auto* p = allocateAligned(size, alignment, "operator new[] on the audio thread"))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return allocateAligned(size, alignment, "operator new on the audio thread");
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return allocateAligned(size, alignment, "operator new[] on the audio thread");
+}
+
+void operator delete(void* p, std::align_val_t) noexcept                                { deallocateAligned(p, "operator delete on the audio thread"); }
+void operator delete[](void* p, std::align_val_t) noexcept                              { deallocateAligned(p, "operator delete[] on the audio thread"); }
+void operator delete(void* p, std::size_t, std::align_val_t alignment) noexcept         { operator delete(p, alignment); }
+void operator delete[](void* p, std::size_t, std::align_val_t alignment) noexcept       { operator delete[](p, alignment); }
+void operator delete(void* p, std::align_val_t alignment, const std::nothrow_t&) noexcept   { operator delete(p, alignment); }
+void operator delete[](void* p, std::align_val_t alignment, const std::nothrow_t&) noexcept { operator delete[](p, alignment); }
+
+#endif
@@ -0,0 +1,97 @@
+/*
+  ==============================================================================
+
+    RealtimeSafetyChecker.h
+
+    Debug-only guard for the audio thread. With BAGS_RT_SAFETY_CHECKS set (the
+    Debug configuration does) processBlock marks its thread as the audio
+    thread, and the replaced global operator new/delete (aligned ones too),
+    the MSVC debug CRT allocation hook and our own lock sites report any call
+    made from it, once each. The scope also keeps the worst and average time
+    per processBlock call.
+
+    What it can't see: malloc outside the MSVC debug CRT (there's no portable
+    hook, glibc dropped __malloc_hook), allocations made inside the host or
+    other modules, and locks taken by code that doesn't mark itself with
+    BAGS_RT_ASSERT_NOT_AUDIO_THREAD - std::mutex and the OS primitives can't
+    be intercepted without linker tricks.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#ifndef BAGS_RT_SAFETY_CHECKS
+ #define BAGS_RT_SAFETY_CHECKS 0
+#endif
+
+#if BAGS_RT_SAFETY_CHECKS
+
+//==============================================================================
+class RealtimeSafetyChecker
+{
+public:
+    // Marks the current thread as the audio thread and times the call
+    class ScopedAudioThread
+    {
+    public:
+        ScopedAudioThread(int numSamples, double sampleRate) noexcept;
+        ~ScopedAudioThread() noexcept;
+
+    private:
+        juce::int64 startTicks;
+        double budgetSeconds;
+        bool wasOnAudioThread;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedAudioThread)
+    };
+
+    // For the rare deliberate exception, e.g. a host callback we can't avoid
+    class ScopedAllowViolations
+    {
+    public:
+        ScopedAllowViolations() noexcept;
+        ~ScopedAllowViolations() noexcept;
+
+    private:
+        bool wasAllowed;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedAllowViolations)
+    };
+
+    static bool isOnAudioThread() noexcept;
+
+    // what must be a string literal, it's kept as the last violation. Never allocates.
+    static void reportViolation(const char* what) noexcept;
+
+    struct Statistics
+    {
+        int numViolations;
+        const char* lastViolation;     // nullptr if there were none
+        int numCalls;
+        double worstSeconds;
+        double averageSeconds;
+        double worstLoad;              // worst call time over the block's duration
+    };
+
+    static Statistics getStatistics() noexcept;
+    static void resetStatistics() noexcept;
+
+    // Break into the debugger on every violation (on by default), or only count them
+    static void setAssertOnViolation(bool shouldAssert) noexcept;
+};
+
+ #define BAGS_RT_SAFETY_SCOPE(numSamples, sampleRate) \
+    const RealtimeSafetyChecker::ScopedAudioThread rtSafetyScope ((numSamples), (sampleRate))
+
+ #define BAGS_RT_ASSERT_NOT_AUDIO_THREAD(what) \
+    do { if (RealtimeSafetyChecker::isOnAudioThread()) RealtimeSafetyChecker::reportViolation (what); } while (false)
+
+#else
+
+ #define BAGS_RT_SAFETY_SCOPE(numSamples, sampleRate)
+ #define BAGS_RT_ASSERT_NOT_AUDIO_THREAD(what)
+
+#endif
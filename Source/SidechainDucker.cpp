@@ -0,0 +1,91 @@
+/*
+  ==============================================================================
+
+    SidechainDucker.cpp
+
+  ==============================================================================
+*/
+
+#include "SidechainDucker.h"
+
+namespace
+{
+    // Over this many dB above the threshold the full depth is reached
+    constexpr float kneeWidth = 6.0f;
+
+    float coefficientFor(float milliseconds, double controlRate) noexcept
+    {
+        auto steps = milliseconds / 1000.0 * controlRate;
+        return steps > 0.0 ? static_cast<float>(std::exp(-1.0 / steps)) : 0.0f;
+    }
+}
+
+//==============================================================================
+void SidechainDucker::prepare(double sampleRate, int maximumBlockSize)
+{
+    controlRate = sampleRate / controlInterval;
+    maxBlockSize = juce::jmax(1, maximumBlockSize);
+    gains.malloc((size_t) maxBlockSize);
+
+    reset();
+}
+
+void SidechainDucker::reset() noexcept
+{
+    envelope = 0.0f;
+    periodPosition = 0;
+    periodPeak = 0.0f;
+    rampStart = 1.0f;
+    rampTarget = 1.0f;
+}
+
+void SidechainDucker::setParameters(float thresholdDb, float depth, float attack, float release) noexcept
+{
+    threshold = thresholdDb;
+    duckDepth = juce::jlimit(0.0f, 1.0f, depth);
+    attackCoefficient = coefficientFor(attack, controlRate);
+    releaseCoefficient = coefficientFor(release, controlRate);
+}
+
+const float* SidechainDucker::process(const juce::AudioBuffer<float>& sidechain, int startSample, int numSamples) noexcept
+{
+    jassert(numSamples <= maxBlockSize);
+    numSamples = juce::jmin(numSamples, maxBlockSize);
+
+    for (int pos = 0; pos < numSamples;)
+    {
+        // Up to the end of the current period, which may have started in an earlier call
+        auto length = juce::jmin(controlInterval - periodPosition, numSamples - pos);
+
+        // Peak of this control period across all sidechain channels
+        for (int channel = 0; channel < sidechain.getNumChannels(); ++channel)
+        {
+            auto range = juce::FloatVectorOperations::findMinAndMax(sidechain.getReadPointer(channel, startSample + pos), length);
+            periodPeak = juce::jmax(periodPeak, -range.getStart(), range.getEnd());
+        }
+
+        // The gain ramps towards what the previous period asked for
+        auto step = (rampTarget - rampStart) / (float) controlInterval;
+
+        for (int i = 0; i < length; ++i)
+            gains[pos + i] = rampStart + step * (float) (periodPosition + i + 1);
+
+        pos += length;
+        periodPosition += length;
+
+        if (periodPosition < controlInterval)
+            break;
+
+        auto coefficient = periodPeak > envelope ? attackCoefficient : releaseCoefficient;
+        envelope = periodPeak + coefficient * (envelope - periodPeak);
+
+        auto overThreshold = juce::Decibels::gainToDecibels(envelope) - threshold;
+        rampStart = rampTarget;
+        rampTarget = 1.0f - duckDepth * juce::jlimit(0.0f, 1.0f, overThreshold / kneeWidth);
+
+        periodPosition = 0;
+        periodPeak = 0.0f;
+    }
+
+    return gains;
+}
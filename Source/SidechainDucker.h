@@ -0,0 +1,58 @@
+/*
+  ==============================================================================
+
+    SidechainDucker.h
+
+    Envelope follower on the sidechain input which produces a gain curve for
+    the delay and reverb returns. The envelope is only evaluated once every
+    controlInterval samples and the gain is ramped linearly over the period
+    after, so the per sample cost is a single multiply-add. Periods run on
+    across process calls, so the attack and release times don't depend on
+    the host block size or where MIDI events split it.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+class SidechainDucker
+{
+public:
+    static constexpr int controlInterval = 32;
+
+    SidechainDucker() = default;
+
+    void prepare(double sampleRate, int maximumBlockSize);
+    void reset() noexcept;
+
+    // depth is 0..1, the gain the wet signal is pulled down by once the sidechain is
+    // a few dB over the threshold. Attack and release are in milliseconds.
+    void setParameters(float thresholdDb, float depth, float attack, float release) noexcept;
+
+    // Follows numSamples of the sidechain starting at startSample and returns the gain
+    // for each of those samples. numSamples must not exceed the prepared block size.
+    const float* process(const juce::AudioBuffer<float>& sidechain, int startSample, int numSamples) noexcept;
+
+private:
+    double controlRate{ 44100.0 / controlInterval };
+    juce::HeapBlock<float> gains;
+    int maxBlockSize{ 0 };
+
+    float threshold{ -30.0f };  // dB
+    float duckDepth{ 0.0f };
+    float attackCoefficient{ 0.0f }, releaseCoefficient{ 0.0f };
+
+    float envelope{ 0.0f };
+
+    // The period in progress, carried over between calls
+    int periodPosition{ 0 };
+    float periodPeak{ 0.0f };
+
+    // Gain ramp from rampStart to rampTarget over the current period
+    float rampStart{ 1.0f }, rampTarget{ 1.0f };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SidechainDucker)
+};
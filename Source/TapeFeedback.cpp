@@ -0,0 +1,134 @@
+/*
+  ==============================================================================
+
+    TapeFeedback.cpp
+
+  ==============================================================================
+*/
+
+#include "TapeFeedback.h"
+
+namespace
+{
+    constexpr double wowRate = 0.6;        // Hz
+    constexpr double flutterRate = 7.3;    // Hz
+
+    // Gain of a TPT one-pole at cutoff
+    float onePoleCoefficient(float cutoff, double sampleRate) noexcept
+    {
+        auto g = std::tan(juce::MathConstants<double>::pi * juce::jlimit(10.0, 0.49 * sampleRate, (double) cutoff) / sampleRate);
+        return static_cast<float>(g / (1.0 + g));
+    }
+}
+
+//==============================================================================
+void TapeFeedback::prepare(double sampleRate, int maximumBlockSize)
+{
+    currentSampleRate = sampleRate;
+    maxBlockSize = juce::jmax(1, maximumBlockSize);
+    modulation.malloc((size_t) maxBlockSize);
+
+    auto twoPi = juce::MathConstants<double>::twoPi;
+    wowRotSin = static_cast<float>(std::sin(twoPi * wowRate / sampleRate));
+    wowRotCos = static_cast<float>(std::cos(twoPi * wowRate / sampleRate));
+    flutterRotSin = static_cast<float>(std::sin(twoPi * flutterRate / sampleRate));
+    flutterRotCos = static_cast<float>(std::cos(twoPi * flutterRate / sampleRate));
+
+    maxModulationSamples = static_cast<float>(2.0 * (maxWowDepth + maxFlutterDepth) / 1000.0 * sampleRate);
+
+    reset();
+}
+
+void TapeFeedback::reset() noexcept
+{
+    std::fill(std::begin(lowCutState), std::end(lowCutState), 0.0f);
+    std::fill(std::begin(highCutState), std::end(highCutState), 0.0f);
+
+    wowSin = 0.0f;      wowCos = 1.0f;
+    flutterSin = 0.0f;  flutterCos = 1.0f;
+}
+
+void TapeFeedback::setParameters(float lowCut, float highCut, float drive, float wow, float flutter) noexcept
+{
+    lowCutCoefficient = onePoleCoefficient(lowCut, currentSampleRate);
+    highCutCoefficient = onePoleCoefficient(highCut, currentSampleRate);
+    driveGain = 1.0f + 7.0f * juce::jlimit(0.0f, 1.0f, drive);
+
+    auto msToSamples = static_cast<float>(currentSampleRate / 1000.0);
+    wowDepth = juce::jlimit(0.0f, 1.0f, wow) * maxWowDepth * msToSamples;
+    flutterDepth = juce::jlimit(0.0f, 1.0f, flutter) * maxFlutterDepth * msToSamples;
+}
+
+//==============================================================================
+const float* TapeFeedback::advanceModulation(int numSamples) noexcept
+{
+    jassert(numSamples <= maxBlockSize);
+    numSamples = juce::jmin(numSamples, maxBlockSize);
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        // Offsets only ever push the heads back, so the delay never gets shorter than set
+        modulation[i] = wowDepth * (1.0f + wowSin) + flutterDepth * (1.0f + flutterSin);
+
+        auto s = wowSin * wowRotCos + wowCos * wowRotSin;
+        wowCos = wowCos * wowRotCos - wowSin * wowRotSin;
+        wowSin = s;
+
+        s = flutterSin * flutterRotCos + flutterCos * flutterRotSin;
+        flutterCos = flutterCos * flutterRotCos - flutterSin * flutterRotSin;
+        flutterSin = s;
+    }
+
+    // Keep the phasors on the unit circle
+    auto wowNorm = 1.0f / std::sqrt(wowSin * wowSin + wowCos * wowCos);
+    wowSin *= wowNorm;
+    wowCos *= wowNorm;
+
+    auto flutterNorm = 1.0f / std::sqrt(flutterSin * flutterSin + flutterCos * flutterCos);
+    flutterSin *= flutterNorm;
+    flutterCos *= flutterNorm;
+
+    return modulation;
+}
+
+void TapeFeedback::filter(int channel, float* samples, int numSamples) noexcept
+{
+    jassert(juce::isPositiveAndBelow(channel, maxChannels));
+
+    auto low = lowCutState[channel];
+    auto high = highCutState[channel];
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        // high cut, then take the low cut's low pass away
+        auto v = (samples[i] - high) * highCutCoefficient;
+        auto highCut = v + high;
+        high = highCut + v;
+
+        v = (highCut - low) * lowCutCoefficient;
+        auto lowPass = v + low;
+        low = lowPass + v;
+
+        samples[i] = highCut - lowPass;
+    }
+
+    lowCutState[channel] = low;
+    highCutState[channel] = high;
+}
+
+void TapeFeedback::saturate(float* samples, int numSamples) const noexcept
+{
+    juce::FloatVectorOperations::multiply(samples, driveGain, numSamples);
+    kernels->fastTanh(samples, numSamples);
+    juce::FloatVectorOperations::multiply(samples, 1.0f / driveGain, numSamples);
+}
+
+void TapeFeedback::fastTanh(float* samples, int numSamples) noexcept
+{
+    for (int i = 0; i < numSamples; ++i)
+    {
+        auto x = std::min(3.5f, std::max(-3.5f, samples[i]));
+        auto x2 = x * x;
+        samples[i] = x * (945.0f + x2 * (105.0f + x2)) / (945.0f + x2 * (420.0f + 15.0f * x2));
+    }
+}
@@ -0,0 +1,84 @@
+/*
+  ==============================================================================
+
+    TapeFeedback.h
+
+    The tape character for the classic delay: playback head tone (low and high
+    cut), record head saturation and wow/flutter on the read position. The
+    delay processes in chunks no longer than the delay itself, so nothing in
+    here has to run sample by sample inside the feedback loop except the two
+    one-pole filters.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DspKernels.h"
+
+//==============================================================================
+class TapeFeedback
+{
+public:
+    static constexpr int maxChannels = 2;
+    static constexpr float maxWowDepth = 4.0f;        // milliseconds
+    static constexpr float maxFlutterDepth = 0.3f;    // milliseconds
+
+    TapeFeedback() = default;
+
+    void prepare(double sampleRate, int maximumBlockSize);
+    void reset() noexcept;
+
+    // Cutoffs in Hz, drive, wow and flutter 0..1
+    void setParameters(float lowCut, float highCut, float drive, float wow, float flutter) noexcept;
+
+    // Instruction set variant used by saturate, see DspKernels::select
+    void setKernels(const DspKernels& newKernels) noexcept  { kernels = &newKernels; }
+
+    // Largest value advanceModulation can return, in samples
+    float getMaxModulationSamples() const noexcept   { return maxModulationSamples; }
+
+    // Steps wow and flutter on by numSamples and returns how far the read position is
+    // pushed back for each of them, in samples. Shared by both channels.
+    const float* advanceModulation(int numSamples) noexcept;
+
+    // Playback head tone, in place
+    void filter(int channel, float* samples, int numSamples) noexcept;
+
+    // Record head saturation, in place. Unity gain for small signals whatever the drive.
+    void saturate(float* samples, int numSamples) const noexcept;
+
+    //==============================================================================
+    // Rational approximation of tanh, x (945 + 105x^2 + x^4) / (945 + 420x^2 + 15x^4)
+    // with x clamped to +-3.5. Monotonic, stays below 1 and is within 1.1e-3 of
+    // std::tanh everywhere (within 1e-6 for |x| < 0.5).
+    static float fastTanh(float x) noexcept
+    {
+        x = juce::jlimit(-3.5f, 3.5f, x);
+        auto x2 = x * x;
+        return x * (945.0f + x2 * (105.0f + x2)) / (945.0f + x2 * (420.0f + 15.0f * x2));
+    }
+
+    // Same as above over a block, the scalar reference for DspKernels::fastTanh
+    static void fastTanh(float* samples, int numSamples) noexcept;
+
+private:
+    double currentSampleRate{ 44100.0 };
+    const DspKernels* kernels{ &DspKernels::getScalar() };
+
+    float lowCutCoefficient{ 0.0f }, highCutCoefficient{ 1.0f };
+    float lowCutState[maxChannels]{}, highCutState[maxChannels]{};
+    float driveGain{ 1.0f };
+
+    // Wow and flutter as rotating phasors, so there's no sin() per sample
+    float wowDepth{ 0.0f }, flutterDepth{ 0.0f };   // samples
+    float wowSin{ 0.0f }, wowCos{ 1.0f }, wowRotSin{ 0.0f }, wowRotCos{ 1.0f };
+    float flutterSin{ 0.0f }, flutterCos{ 1.0f }, flutterRotSin{ 0.0f }, flutterRotCos{ 1.0f };
+    float maxModulationSamples{ 0.0f };
+
+    juce::HeapBlock<float> modulation;
+    int maxBlockSize{ 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TapeFeedback)
+};
@@ -0,0 +1,707 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Golden render tests for the processor. Every configuration renders an
+    impulse, a sine sweep and noise at one or more sample rates, and each
+    render is checked three ways (configurations can also send timed MIDI, feed
+    the sidechain or bypass part of the render):
+
+      - against its golden file in Tests/Golden, rendered with the scalar
+        kernels at the reference block size and stored decimated to about
+        one frame per millisecond. Renders without a golden file yet are
+        counted as skipped, not failed,
+      - at every block size against the reference block size, sample by
+        sample, so block splitting never changes the sound,
+      - with the kernels picked for this CPU against the scalar ones.
+
+    With BAGS_RT_SAFETY_CHECKS set (the Debug configuration does) any
+    allocation or lock inside processBlock fails the render too.
+
+      RenderTests                   run every check, exits with 1 on a failure
+      RenderTests --update          rewrite the golden files from the current code
+      RenderTests --golden <dir>    golden files somewhere other than Tests/Golden
+      RenderTests --benchmark       time every kernel variant, see DspKernels::createBenchmarkReport
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Source/PluginProcessor.h"
+
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace
+{
+    //==============================================================================
+    enum class Signal { impulse, sweep, noise };
+    constexpr Signal signals[] = { Signal::impulse, Signal::sweep, Signal::noise };
+    const char* const signalNames[] = { "impulse", "sweep", "noise" };
+
+    constexpr double referenceRate = 48000.0;
+    constexpr double otherRates[] = { 44100.0, 96000.0 };
+    constexpr int referenceBlockSize = 512;
+    constexpr int otherBlockSizes[] = { 1, 64, 480, 2048 };
+
+    //==============================================================================
+    struct TimedMidi
+    {
+        double time;                // seconds into the render
+        juce::MidiMessage message;
+    };
+
+    struct Configuration
+    {
+        std::string name;
+        std::function<void (BagsComboAudioProcessor&)> setUp;
+
+        float tolerance = 1.0e-4f;          // against the golden file
+        float blockTolerance = 1.0e-5f;     // between block sizes and kernel variants
+        bool allRates = false;              // also 44.1 and 96 kHz, otherwise just the reference rate
+        double seconds = 1.0;
+
+        // Applied once, at the sample half way through the render
+        std::function<void (BagsComboAudioProcessor&)> halfway;
+
+        std::vector<TimedMidi> midi;
+
+        // Rendered through processBlockBypassed in between, both in seconds
+        double bypassStart = -1.0;
+        double bypassEnd = -1.0;
+    };
+
+    std::vector<Configuration> createConfigurations()
+    {
+        using Processor = BagsComboAudioProcessor;
+        std::vector<Configuration> configurations;
+
+        auto add = [&configurations] (std::string name, std::function<void (Processor&)> setUp) -> Configuration&
+        {
+            Configuration configuration;
+            configuration.name = std::move(name);
+            configuration.setUp = std::move(setUp);
+
+            configurations.push_back(std::move(configuration));
+            return configurations.back();
+        };
+
+        // Delays, reverb left at its defaults
+        add("classic", [] (Processor& p) { p.delayTime = 250.0f; p.delayLevel = 0.6f; }).allRates = true;
+
+        for (auto level : { 0.3f, 0.9f })
+        {
+            for (auto time : { 30.0f, 400.0f })
+            {
+                add("classic_" + std::to_string(juce::roundToInt(level * 100)) + "_" + std::to_string(juce::roundToInt(time)),
+                    [level, time] (Processor& p) { p.delayTime = time; p.delayLevel = level; p.wetLevel = 0.0f; });
+            }
+        }
+
+        add("stereo", [] (Processor& p)
+        {
+            p.delayMode = Processor::DelayMode::stereo;
+            p.delayTime = 180.0f;
+            p.delayTimeRight = 270.0f;
+            p.delayLevel = 0.6f;
+            p.crossFeedback = 0.5f;
+            p.delayWidth = 0.8f;
+        }).allRates = true;
+
+        add("stereo_mid_side", [] (Processor& p)
+        {
+            p.delayMode = Processor::DelayMode::stereo;
+            p.delayMidSide = true;
+            p.delayTime = 120.0f;
+            p.delayTimeRight = 200.0f;
+            p.delayLevel = 0.7f;
+            p.crossFeedback = 1.0f;
+        });
+
+        // The wow and flutter LFOs and the saturation go through libm, which differs a bit between
+        // compilers, and their phasors are renormalised once per chunk, which follows the block size
+        auto& tape = add("tape", [] (Processor& p)
+        {
+            p.tapeMode = true;
+            p.delayTime = 300.0f;
+            p.delayLevel = 0.7f;
+            p.tapeDrive = 0.6f;
+            p.tapeWow = 0.4f;
+            p.tapeFlutter = 0.4f;
+        });
+        tape.allRates = true;
+        tape.tolerance = 5.0e-4f;
+        tape.blockTolerance = 5.0e-4f;
+
+        add("diffusion", [] (Processor& p)
+        {
+            p.delayTime = 200.0f;
+            p.delayLevel = 0.7f;
+            p.delayDiffusion = 0.7f;
+            p.diffusionSize = 0.6f;
+            p.diffusionStages = 8;
+        });
+
+        // Past maxDelayTime, so the repeat only arrives after a second and a bit
+        auto& longDelay = add("long", [] (Processor& p)
+        {
+            p.longDelayMode = true;
+            p.delayTime = 1200.0f;
+            p.delayLevel = 0.6f;
+        });
+        longDelay.seconds = 1.6;
+
+        auto& freeze = add("freeze", [] (Processor& p) { p.delayTime = 200.0f; p.delayLevel = 0.7f; });
+        freeze.halfway = [] (Processor& p) { p.freeze = true; };
+
+        // Reverbs, with the delay out of the way
+        add("early_reflections", [] (Processor& p)
+        {
+            p.delayLevel = 0.0f;
+            p.earlyLevel = 0.5f;
+            p.preDelay = 20.0f;
+        });
+
+        for (auto size : { 0.2f, 0.9f })
+        {
+            for (auto damping : { 0.1f, 0.8f })
+            {
+                add("freeverb_" + std::to_string(juce::roundToInt(size * 100)) + "_" + std::to_string(juce::roundToInt(damping * 100)),
+                    [size, damping] (Processor& p) { p.delayLevel = 0.0f; p.roomSize = size; p.damp = damping; p.wetLevel = 0.5f; });
+            }
+        }
+
+        auto& fdn = add("fdn", [] (Processor& p)
+        {
+            p.delayLevel = 0.0f;
+            p.reverbAlgorithm = Processor::ReverbAlgorithm::fdn;
+            p.roomSize = 0.7f;
+            p.wetLevel = 0.5f;
+        });
+        fdn.allRates = true;
+        fdn.tolerance = 5.0e-4f;
+
+        add("fdn_static", [] (Processor& p)
+        {
+            p.delayLevel = 0.0f;
+            p.reverbAlgorithm = Processor::ReverbAlgorithm::fdn;
+            p.reverbModulation = false;
+            p.roomSize = 0.4f;
+            p.damp = 0.2f;
+        });
+
+        add("eco_half", [] (Processor& p)
+        {
+            p.delayLevel = 0.0f;
+            p.reverbQuality = Processor::ReverbQuality::half;
+            p.wetLevel = 0.5f;
+        }).allRates = true;
+
+        auto& ecoQuarter = add("eco_quarter_fdn", [] (Processor& p)
+        {
+            p.delayLevel = 0.0f;
+            p.reverbAlgorithm = Processor::ReverbAlgorithm::fdn;
+            p.reverbQuality = Processor::ReverbQuality::quarter;
+            p.wetLevel = 0.5f;
+        });
+        ecoQuarter.tolerance = 5.0e-4f;
+
+        // MIDI, landing part way through blocks. A learned CC on a level, one on a switch,
+        // then a division note and taps that set the delay time from a tapped tempo.
+        auto& midiControl = add("midi_cc", [] (Processor& p)
+        {
+            p.delayTime = 200.0f;
+            p.delayLevel = 0.3f;
+            p.wetLevel = 0.4f;
+            p.getMidiControl().setMapping(1, static_cast<int>(Processor::Parameter::delayLevel));
+            p.getMidiControl().setMapping(2, static_cast<int>(Processor::Parameter::reverbAlgorithm));
+        });
+        midiControl.midi = { { 0.21, juce::MidiMessage::controllerEvent(1, 1, 110) },
+                             { 0.43, juce::MidiMessage::controllerEvent(1, 2, 127) },
+                             { 0.71, juce::MidiMessage::controllerEvent(1, 1, 20) } };
+
+        auto& midiTap = add("midi_tap_division", [] (Processor& p) { p.delayTime = 100.0f; p.delayLevel = 0.6f; });
+        midiTap.midi = { { 0.05, juce::MidiMessage::noteOn(1, 50, (juce::uint8) 100) },
+                         { 0.17, juce::MidiMessage::noteOn(1, 24, (juce::uint8) 100) },
+                         { 0.47, juce::MidiMessage::noteOn(1, 24, (juce::uint8) 100) },
+                         { 0.77, juce::MidiMessage::noteOn(1, 24, (juce::uint8) 100) } };
+
+        // The sidechain gets a burst every quarter of a second, see fillSidechain
+        add("sidechain_ducking", [] (Processor& p)
+        {
+            p.enableAllBuses();
+            p.duckingEnabled = true;
+            p.duckThreshold = -20.0f;
+            p.duckDepth = 0.8f;
+            p.delayTime = 150.0f;
+            p.delayLevel = 0.6f;
+            p.wetLevel = 0.5f;
+        }).allRates = true;
+
+        // The envelope on the sidechain (or the input when there is none) and the LFOs
+        auto& modulation = add("modulation", [] (Processor& p)
+        {
+            using Matrix = ModulationMatrix;
+            p.enableAllBuses();
+            p.delayTime = 250.0f;
+            p.delayLevel = 0.6f;
+            p.wetLevel = 0.4f;
+
+            auto& matrix = p.getModulationMatrix();
+            matrix.lfos[0] = { Matrix::Shape::sine, 3.0f };
+            matrix.lfos[1] = { Matrix::Shape::triangle, 0.7f };
+            matrix.routes[0] = { true, Matrix::Source::lfo1, Matrix::Destination::delayTime, 0.01f };
+            matrix.routes[1] = { true, Matrix::Source::lfo2, Matrix::Destination::width, -0.5f };
+            matrix.routes[2] = { true, Matrix::Source::envelope2, Matrix::Destination::wetLevel, -0.4f };
+        });
+        modulation.tolerance = 5.0e-4f;
+
+        // Bypassed for a while in the middle of the tails. Ringing out keeps the echoes going under the dry
+        // input, a cut drops them. The cut is long enough to clear the tails at every block size.
+        auto& ringOut = add("bypass_ring_out", [] (Processor& p) { p.delayTime = 250.0f; p.delayLevel = 0.6f; p.wetLevel = 0.5f; });
+        ringOut.bypassStart = 0.3;
+        ringOut.bypassEnd = 0.6;
+
+        auto& cut = add("bypass_cut", [] (Processor& p)
+        {
+            p.bypassMode = Processor::BypassMode::cut;
+            p.delayTime = 250.0f;
+            p.delayLevel = 0.6f;
+            p.wetLevel = 0.5f;
+        });
+        cut.bypassStart = 0.3;
+        cut.bypassEnd = 0.8;
+        cut.seconds = 1.2;
+
+        auto& bypassFreeze = add("bypass_freeze", [] (Processor& p) { p.delayTime = 200.0f; p.delayLevel = 0.7f; });
+        bypassFreeze.halfway = [] (Processor& p) { p.freeze = true; };
+        bypassFreeze.bypassStart = 0.3;
+        bypassFreeze.bypassEnd = 0.7;
+
+        // Everything at once
+        auto& combo = add("combo", [] (Processor& p)
+        {
+            p.tapeMode = true;
+            p.delayTime = 350.0f;
+            p.delayLevel = 0.5f;
+            p.delayDiffusion = 0.4f;
+            p.earlyLevel = 0.3f;
+            p.reverbAlgorithm = Processor::ReverbAlgorithm::fdn;
+            p.roomSize = 0.6f;
+        });
+        combo.allRates = true;
+        combo.tolerance = 5.0e-4f;
+        combo.blockTolerance = 5.0e-4f;
+
+        return configurations;
+    }
+
+    //==============================================================================
+    void fillSignal(juce::AudioBuffer<float>& buffer, Signal signal, double sampleRate)
+    {
+        buffer.clear();
+
+        // Each signal only takes up the first half, the rest shows the tails
+        auto numSamples = buffer.getNumSamples();
+        auto length = numSamples / 2;
+
+        switch (signal)
+        {
+            case Signal::impulse:
+                // A different height per channel, so anything that swaps or sums channels shows
+                buffer.setSample(0, 0, 1.0f);
+                buffer.setSample(1, 0, 0.5f);
+                break;
+
+            case Signal::sweep:
+            {
+                // Exponential, 20 Hz to just under Nyquist
+                auto startFrequency = 20.0;
+                auto sweepRate = std::log(0.45 * sampleRate / startFrequency);
+                auto duration = length / sampleRate;
+
+                for (int i = 0; i < length; ++i)
+                {
+                    auto phase = juce::MathConstants<double>::twoPi * startFrequency * duration / sweepRate
+                               * (std::exp(sweepRate * i / length) - 1.0);
+
+                    buffer.setSample(0, i, static_cast<float>(0.5 * std::sin(phase)));
+                    buffer.setSample(1, i, static_cast<float>(0.5 * std::cos(phase)));
+                }
+
+                break;
+            }
+
+            case Signal::noise:
+            {
+                // Our own generator, so the golden files don't depend on juce::Random
+                std::uint32_t state = 0x1234567u;
+
+                for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+                {
+                    for (int i = 0; i < length; ++i)
+                    {
+                        state = state * 1664525u + 1013904223u;
+                        buffer.setSample(channel, i, 0.25f * (static_cast<float>(state >> 8) / 8388608.0f - 1.0f));
+                    }
+                }
+
+                break;
+            }
+        }
+    }
+
+    // Bursts of a 200 Hz tone, 50 ms every 250 ms, for the ducker to follow
+    void fillSidechain(juce::AudioBuffer<float>& buffer, double sampleRate)
+    {
+        auto period = juce::roundToInt(0.25 * sampleRate);
+        auto burst = juce::roundToInt(0.05 * sampleRate);
+
+        for (int i = 0; i < buffer.getNumSamples(); ++i)
+        {
+            auto value = i % period < burst ? static_cast<float>(0.5 * std::sin(juce::MathConstants<double>::twoPi * 200.0 * i / sampleRate))
+                                            : 0.0f;
+
+            for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+                buffer.setSample(channel, i, value);
+        }
+    }
+
+    //==============================================================================
+    struct Render
+    {
+        juce::AudioBuffer<float> output;
+        std::string violation;      // empty unless processBlock allocated or locked
+    };
+
+    Render render(const Configuration& configuration, Signal signal, double sampleRate, int blockSize, bool scalarKernels)
+    {
+        BagsComboAudioProcessor processor;
+        configuration.setUp(processor);
+        processor.forceScalarKernels = scalarKernels;
+        processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+        processor.prepareToPlay(sampleRate, blockSize);
+        processor.reset();
+
+        auto numSamples = juce::roundToInt(configuration.seconds * sampleRate);
+        auto halfway = configuration.halfway != nullptr ? numSamples / 2 : numSamples;
+        auto bypassStart = configuration.bypassStart >= 0.0 ? juce::roundToInt(configuration.bypassStart * sampleRate) : numSamples;
+        auto bypassEnd = configuration.bypassEnd >= 0.0 ? juce::roundToInt(configuration.bypassEnd * sampleRate) : numSamples;
+
+        Render result;
+        result.output.setSize(2, numSamples);
+        fillSignal(result.output, signal, sampleRate);
+
+        // Only the main output gets compared, the sidechain (when the set up enabled it) rides along after it
+        auto hasSidechain = processor.getTotalNumInputChannels() > 2;
+        juce::AudioBuffer<float> sidechain(2, hasSidechain ? numSamples : 0);
+        fillSidechain(sidechain, sampleRate);
+
+        float* channels[] = { result.output.getWritePointer(0), result.output.getWritePointer(1),
+                              sidechain.getWritePointer(0), sidechain.getWritePointer(1) };
+
+        juce::MidiBuffer midi;
+
+       #if BAGS_RT_SAFETY_CHECKS
+        RealtimeSafetyChecker::resetStatistics();
+       #endif
+
+        for (int start = 0; start < numSamples;)
+        {
+            if (start == halfway)
+                configuration.halfway(processor);
+
+            // Blocks are cut at the half way point and the bypass edges, so every block size sees the
+            // changes on the same sample. MIDI lands wherever it falls inside a block.
+            auto end = juce::jmin(numSamples, start + blockSize);
+
+            for (auto cut : { halfway, bypassStart, bypassEnd })
+                if (start < cut && end > cut)
+                    end = cut;
+
+            midi.clear();
+
+            for (auto& event : configuration.midi)
+            {
+                auto position = juce::roundToInt(event.time * sampleRate);
+
+                if (position >= start && position < end)
+                    midi.addEvent(event.message, position - start);
+            }
+
+            juce::AudioBuffer<float> block(channels, hasSidechain ? 4 : 2, start, end - start);
+
+            if (start >= bypassStart && start < bypassEnd)
+                processor.processBlockBypassed(block, midi);
+            else
+                processor.processBlock(block, midi);
+
+            start = end;
+        }
+
+       #if BAGS_RT_SAFETY_CHECKS
+        auto statistics = RealtimeSafetyChecker::getStatistics();
+
+        if (statistics.numViolations > 0)
+            result.violation = std::to_string(statistics.numViolations) + " realtime violations, last "
+                             + statistics.lastViolation;
+       #endif
+
+        processor.releaseResources();
+        return result;
+    }
+
+    //==============================================================================
+    // Stored as three int32s (channels, frames, decimation) then the interleaved float32 frames
+    struct Golden
+    {
+        int numChannels = 0;
+        int numFrames = 0;
+        int decimation = 1;
+        std::vector<float> frames;
+    };
+
+    int getDecimation(double sampleRate)
+    {
+        return juce::jmax(1, juce::roundToInt(sampleRate / 1000.0));
+    }
+
+    Golden decimate(const juce::AudioBuffer<float>& buffer, double sampleRate)
+    {
+        Golden golden;
+        golden.numChannels = buffer.getNumChannels();
+        golden.decimation = getDecimation(sampleRate);
+        golden.numFrames = (buffer.getNumSamples() + golden.decimation - 1) / golden.decimation;
+        golden.frames.reserve((size_t) (golden.numFrames * golden.numChannels));
+
+        for (int frame = 0; frame < golden.numFrames; ++frame)
+            for (int channel = 0; channel < golden.numChannels; ++channel)
+                golden.frames.push_back(buffer.getSample(channel, frame * golden.decimation));
+
+        return golden;
+    }
+
+    bool writeGolden(const std::filesystem::path& file, const Golden& golden)
+    {
+        std::ofstream stream(file, std::ios::binary);
+        std::int32_t header[] = { golden.numChannels, golden.numFrames, golden.decimation };
+
+        stream.write(reinterpret_cast<const char*>(header), sizeof(header));
+        stream.write(reinterpret_cast<const char*>(golden.frames.data()), (std::streamsize) (golden.frames.size() * sizeof(float)));
+
+        return stream.good();
+    }
+
+    bool readGolden(const std::filesystem::path& file, Golden& golden)
+    {
+        std::ifstream stream(file, std::ios::binary);
+        std::int32_t header[3] = {};
+
+        if (! stream.read(reinterpret_cast<char*>(header), sizeof(header)))
+            return false;
+
+        golden.numChannels = header[0];
+        golden.numFrames = header[1];
+        golden.decimation = header[2];
+
+        if (golden.numChannels <= 0 || golden.numFrames <= 0 || golden.decimation <= 0)
+            return false;
+
+        golden.frames.resize((size_t) (golden.numChannels * golden.numFrames));
+        return (bool) stream.read(reinterpret_cast<char*>(golden.frames.data()), (std::streamsize) (golden.frames.size() * sizeof(float)));
+    }
+
+    // Largest difference, or infinity if the shapes differ or anything isn't finite
+    float getDifference(const Golden& a, const Golden& b)
+    {
+        if (a.numChannels != b.numChannels || a.numFrames != b.numFrames || a.decimation != b.decimation)
+            return std::numeric_limits<float>::infinity();
+
+        auto difference = 0.0f;
+
+        for (size_t i = 0; i < a.frames.size(); ++i)
+        {
+            auto d = std::abs(a.frames[i] - b.frames[i]);
+
+            if (! std::isfinite(d))
+                return std::numeric_limits<float>::infinity();
+
+            difference = juce::jmax(difference, d);
+        }
+
+        return difference;
+    }
+
+    float getDifference(const juce::AudioBuffer<float>& a, const juce::AudioBuffer<float>& b)
+    {
+        if (a.getNumChannels() != b.getNumChannels() || a.getNumSamples() != b.getNumSamples())
+            return std::numeric_limits<float>::infinity();
+
+        auto difference = 0.0f;
+
+        for (int channel = 0; channel < a.getNumChannels(); ++channel)
+        {
+            for (int i = 0; i < a.getNumSamples(); ++i)
+            {
+                auto d = std::abs(a.getSample(channel, i) - b.getSample(channel, i));
+
+                if (! std::isfinite(d))
+                    return std::numeric_limits<float>::infinity();
+
+                difference = juce::jmax(difference, d);
+            }
+        }
+
+        return difference;
+    }
+
+    //==============================================================================
+    class RenderTests
+    {
+    public:
+        RenderTests(std::filesystem::path goldenDirectoryToUse, bool shouldUpdate)
+            : goldenDirectory(std::move(goldenDirectoryToUse)), update(shouldUpdate)
+        {
+        }
+
+        int run()
+        {
+            if (update)
+                std::filesystem::create_directories(goldenDirectory);
+
+            for (auto& configuration : createConfigurations())
+            {
+                runRate(configuration, referenceRate);
+
+                if (configuration.allRates)
+                    for (auto rate : otherRates)
+                        runRate(configuration, rate);
+            }
+
+            std::cout << numChecks << " checks, " << numFailures << " failed";
+
+            if (numMissingGoldens > 0)
+                std::cout << ", " << numMissingGoldens << " renders have no golden file yet (run with --update to create them)";
+
+            std::cout << std::endl;
+            return numFailures > 0 ? 1 : 0;
+        }
+
+    private:
+        void runRate(const Configuration& configuration, double sampleRate)
+        {
+            for (auto signal : signals)
+            {
+                auto name = configuration.name + "_" + signalNames[(int) signal] + "_" + std::to_string(juce::roundToInt(sampleRate));
+                auto file = goldenDirectory / (name + ".bin");
+
+                auto scalar = render(configuration, signal, sampleRate, referenceBlockSize, true);
+                checkRender(name, scalar);
+
+                if (update)
+                {
+                    if (! writeGolden(file, decimate(scalar.output, sampleRate)))
+                        fail(name, "couldn't write " + file.string());
+
+                    continue;
+                }
+
+                Golden golden;
+
+                if (! std::filesystem::exists(file))
+                    ++numMissingGoldens;
+                else if (! readGolden(file, golden))
+                    fail(name, "couldn't read " + file.string());
+                else
+                    check(name + " scalar against golden", getDifference(golden, decimate(scalar.output, sampleRate)), configuration.tolerance);
+
+                auto reference = render(configuration, signal, sampleRate, referenceBlockSize, false);
+                checkRender(name, reference);
+                check(name + " kernels against scalar", getDifference(reference.output, scalar.output), configuration.blockTolerance);
+
+                for (auto blockSize : otherBlockSizes)
+                {
+                    auto blockName = name + " block " + std::to_string(blockSize);
+                    auto other = render(configuration, signal, sampleRate, blockSize, false);
+                    checkRender(blockName, other);
+                    check(blockName + " against block " + std::to_string(referenceBlockSize),
+                          getDifference(other.output, reference.output), configuration.blockTolerance);
+                }
+            }
+        }
+
+        void check(const std::string& name, float difference, float tolerance)
+        {
+            ++numChecks;
+
+            // written so a NaN fails too
+            if (! (difference <= tolerance))
+                fail(name, "differs by " + std::to_string(difference) + ", tolerance " + std::to_string(tolerance));
+        }
+
+        void checkRender(const std::string& name, const Render& result)
+        {
+            ++numChecks;
+
+            if (! result.violation.empty())
+                fail(name, result.violation);
+        }
+
+        void fail(const std::string& name, const std::string& message)
+        {
+            ++numFailures;
+            std::cout << "FAILED " << name << ": " << message << std::endl;
+        }
+
+        std::filesystem::path goldenDirectory;
+        bool update;
+        int numChecks = 0;
+        int numFailures = 0;
+        int numMissingGoldens = 0;
+    };
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    // The processor is a juce::Timer, which needs a message manager
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    auto goldenDirectory = std::filesystem::path(__FILE__).parent_path().parent_path() / "Golden";
+    auto update = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string argument(argv[i]);
+
+        if (argument == "--update")
+        {
+            update = true;
+        }
+        else if (argument == "--golden" && i + 1 < argc)
+        {
+            goldenDirectory = argv[++i];
+        }
+        else if (argument == "--benchmark")
+        {
+            // Release builds only give meaningful timings
+            std::cout << DspKernels::createBenchmarkReport().toStdString() << std::endl;
+            return 0;
+        }
+        else
+        {
+            std::cout << "usage: RenderTests [--update] [--golden <dir>] [--benchmark]" << std::endl;
+            return 2;
+        }
+    }
+
+    return RenderTests(goldenDirectory, update).run();
+}